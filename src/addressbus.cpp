@@ -16,8 +16,10 @@
 #include "apu/sound.h"
 #include "cartridge.h"
 #include "gpu/video.h"
+#include "interrupts.h"
 #include "keypad.h"
 #include "link.h"
+#include "profiler.h"
 #include "timer.h"
 #include "utils.h"
 #include "z80.h"
@@ -36,20 +38,38 @@ AddressBus::AddressBus(Cartridge& card,
                        LinkCable& lk,
                        Keypad& kp,
                        Timer& timer,
-                       Sound& snd)
-    : _card(card), _vid(v), _lk(lk), _kp(kp), _timer(timer), _snd(snd) {
+                       Sound& snd,
+                       Interrupts& ints,
+                       Scheduler& sched)
+    : _card(card),
+      _vid(v),
+      _lk(lk),
+      _kp(kp),
+      _timer(timer),
+      _snd(snd),
+      _ints(ints),
+      _sched(sched),
+      _dma(false),
+      _dma_source(0),
+      _code_version(0) {
     using namespace std::placeholders;
     _mem_map = {
         {"cartridge_rom_bank_0",
          0x0000,
          0x3FFF,
          std::bind(&Cartridge::Read, &_card, _1),
-         std::bind(&Cartridge::Write, &_card, _1, _2)},
+         [&](uint16_t index, byte v) {
+             _card.Write(index, v);
+             MapCartridge();
+         }},
         {"cartridge_rom_bank_switchable",
          0x4000,
          0x7FFF,
          std::bind(&Cartridge::Read, &_card, _1),
-         std::bind(&Cartridge::Write, &_card, _1, _2)},
+         [&](uint16_t index, byte v) {
+             _card.Write(index, v);
+             MapCartridge();
+         }},
         {"vram",
          0x8000,
          0x97FF,
@@ -132,8 +152,8 @@ AddressBus::AddressBus(Cartridge& card,
         {"int_flag",
          0xFF0F,
          0xFF0F,
-         [&](uint16_t) { return _interrupts; },
-         [&](uint16_t, byte v) { _interrupts = v; }},
+         [&](uint16_t) { return _ints.flags(); },
+         [&](uint16_t, byte v) { _ints.set_flags(v); }},
         {"nr10_sweep",
          0xFF10,
          0xFF10,
@@ -276,10 +296,13 @@ AddressBus::AddressBus(Cartridge& card,
         {"dma",
          0xFF46,
          0xFF46,
-         NotImplementedGet,
-         [&](int, byte v) {
-             for (int i = 0; i < 0x9F; ++i) {
-                 _vid.set_oam(0xFE00 + i, Get((v << 8) + i).u);
+         [&](uint16_t) { return _dma_source; },
+         [&](uint16_t, byte v) {
+             _dma_source = v;
+             _sched.Schedule(Scheduler::DMA, _sched.now() + kDmaCycles);
+             if (!_dma) {
+                 _dma = true;
+                 MapMemory();
              }
          }},
         {"bg_palette",
@@ -317,8 +340,126 @@ AddressBus::AddressBus(Cartridge& card,
         {"interrupt_master_enable",
          0xFFFF,
          0xFFFF,
-         [&](uint16_t) { return _int_mask; },
-         [&](uint16_t, byte v) { _int_mask = v; }}};
+         [&](uint16_t) { return _ints.enable(); },
+         [&](uint16_t, byte v) { _ints.set_enable(v); }}};
+
+    _code_pages.fill(false);
+    MapMemory();
+
+    for (int i = 0; i < 0x100; ++i) {
+        _io_ports[i] = &FindAddr(0xFF00 + i);
+    }
+}
+
+void AddressBus::MapPages(uint16_t begin,
+                          uint16_t end,
+                          const byte* r,
+                          byte* w) {
+    for (int page = begin >> 8; page <= end >> 8; ++page) {
+        int offset = (page << 8) - begin;
+        _read_pages[page] = r ? r + offset : nullptr;
+        _write_pages[page] = w ? w + offset : nullptr;
+    }
+}
+
+void AddressBus::MapMemory() {
+    _read_pages.fill(nullptr);
+    _write_pages.fill(nullptr);
+    if (_dma) {
+        ++_code_version;
+        return;
+    }
+    MapCartridge();
+    // Tile data writes go through Video::set_vram to update the tile cache
+    byte* vram = reinterpret_cast<byte*>(_vid.vram_ptr());
+    MapPages(0x8000, 0x97FF, vram, nullptr);
+    MapPages(0x9800, 0x9FFF, vram + 0x1800, vram + 0x1800);
+    byte* wram = reinterpret_cast<byte*>(&_wram0[0]);
+    MapPages(0xC000, 0xDFFF, wram, wram);
+    MapPages(0xE000, 0xFDFF, wram, wram);
+    for (int page = 0; page < 0x100; ++page) {
+        if (_code_pages[page]) {
+            _write_pages[page] = nullptr;
+        }
+    }
+}
+
+void AddressBus::FinishDma() {
+    _sched.Cancel(Scheduler::DMA);
+    _dma = false;
+    MapMemory();
+    // Sources above WRAM read its echo
+    const int source = _dma_source >= 0xE0 ? _dma_source - 0x20 : _dma_source;
+    const byte* page = _read_pages[source];
+    if (page) {
+        _vid.CopyOam(page);
+        return;
+    }
+    byte oam[0xA0];
+    for (int i = 0; i < 0xA0; ++i) {
+        oam[i] = Get(source << 8 | i).u;
+    }
+    _vid.CopyOam(oam);
+}
+
+void AddressBus::MapCartridge() {
+    MapPages(0x0000, 0x3FFF, _card.rom_bank0(), nullptr);
+    MapPages(0x4000, 0x7FFF, _card.rom_bankn(), nullptr);
+    MapPages(0xA000, 0xBFFF, _card.ram_bank(), _card.ram_bank());
+    ++_code_version;
+}
+
+const byte* AddressBus::code_ptr(uint16_t index) const {
+    if (index < 0x8000 || (index >= 0xC000 && index < 0xE000)) {
+        const byte* page = _read_pages[index >> 8];
+        return page ? page + (index & 0xFF) : nullptr;
+    } else if (index >= 0xFF80 && index < 0xFFFF) {
+        return &_hram[index - 0xFF80u].u;
+    }
+    return nullptr;
+}
+
+int AddressBus::rom_offset(const byte* code) const {
+    if (code >= _card.rom() && code < _card.rom() + _card.rom_size()) {
+        return code - _card.rom();
+    }
+    return -1;
+}
+
+void AddressBus::WatchCode(uint16_t index) {
+    int page = index >> 8;
+    if (page >= 0xC0 && page < 0xE0) {
+        _code_pages[page] = true;
+        _write_pages[page] = nullptr;
+        // Its echo, if any
+        if (page + 0x20 < 0xFE) {
+            _code_pages[page + 0x20] = true;
+            _write_pages[page + 0x20] = nullptr;
+        }
+    } else if (page == 0xFF) {
+        _code_pages[page] = true;
+    }
+}
+
+void AddressBus::CodeWritten(int page) {
+    ++_code_version;
+    if (page == 0xFF) {
+        _code_pages[page] = false;
+        _code_written(&_hram[0].u, _hram.size());
+        return;
+    }
+
+    if (page >= 0xE0) {
+        page -= 0x20;
+    }
+    byte* wram = &_wram0[(page - 0xC0) << 8].u;
+    _code_pages[page] = false;
+    _write_pages[page] = wram;
+    if (page + 0x20 < 0xFE) {
+        _code_pages[page + 0x20] = false;
+        _write_pages[page + 0x20] = wram;
+    }
+    _code_written(wram, 0x100);
 }
 
 const AddressBus::Addr& AddressBus::FindAddr(uint16_t addr) const {
@@ -342,12 +483,56 @@ const AddressBus::Addr& AddressBus::FindAddr(uint16_t addr) const {
     }
 }
 
-void AddressBus::Set(uint16_t index, Data8 val) {
-    return FindAddr(index)._set(index, val.u);
+void AddressBus::SetSlow(uint16_t index, Data8 val) {
+    ProfileScope scope(Profiler::BUS);
+    if (_dma && index < 0xFF00) {
+        return;
+    } else if (index >= 0xFF80 && index < 0xFFFF) {
+        if (_code_pages[0xFF]) {
+            CodeWritten(0xFF);
+        }
+        _hram[index - 0xFF80u].u = val.u;
+    } else if (index >= 0xFF00) {
+        _io_ports[index - 0xFF00u]->_set(index, val.u);
+    } else {
+        if (_code_pages[index >> 8]) {
+            CodeWritten(index >> 8);
+        }
+        FindAddr(index)._set(index, val.u);
+    }
+}
+
+Data8 AddressBus::GetSlow(uint16_t index) const {
+    ProfileScope scope(Profiler::BUS);
+    if (_dma && index < 0xFF00) {
+        return uint8_t(0xFF);
+    } else if (index >= 0xFF80 && index < 0xFFFF) {
+        return _hram[index - 0xFF80u];
+    } else if (index >= 0xFF00) {
+        return _io_ports[index - 0xFF00u]->_get(index);
+    } else {
+        return FindAddr(index)._get(index);
+    }
+}
+
+void AddressBus::SaveState(StateWriter& w) const {
+    w.Write(_hram);
+    w.Write(_wram0);
+    w.Write(_dma);
+    w.Write(_dma_source);
 }
 
-Data8 AddressBus::Get(uint16_t index) const {
-    return FindAddr(index)._get(index);
+void AddressBus::LoadState(StateReader& r) {
+    r.Read(_hram);
+    r.Read(_wram0);
+    r.Read(_dma);
+    r.Read(_dma_source);
+    for (int page = 0; page < 0x100; ++page) {
+        if (_code_pages[page]) {
+            CodeWritten(page);
+        }
+    }
+    MapMemory();
 }
 
 std::string AddressBus::Print(uint16_t index) const {
@@ -4,10 +4,13 @@
 #include <functional>
 #include <vector>
 
+#include "scheduler.h"
+#include "state.h"
 #include "utils.h"
 
 class Keypad;
 class Cartridge;
+class Interrupts;
 class Video;
 class LinkCable;
 class Timer;
@@ -20,13 +23,68 @@ class AddressBus {
                LinkCable& lk,
                Keypad& kp,
                Timer& timer,
-               Sound& snd);
+               Sound& snd,
+               Interrupts& ints,
+               Scheduler& sched);
 
-    void Set(uint16_t index, Data8 val);
+    // Pages backed by plain memory are accessed through a direct pointer,
+    // the others go through the handlers of _mem_map.
+    void Set(uint16_t index, Data8 val) {
+        byte* page = _write_pages[index >> 8];
+        if (page) {
+            page[index & 0xFF] = val.u;
+            return;
+        }
+        SetSlow(index, val);
+    }
 
-    Data8 Get(uint16_t index) const;
+    Data8 Get(uint16_t index) const {
+        const byte* page = _read_pages[index >> 8];
+        if (page) {
+            return page[index & 0xFF];
+        }
+        return GetSlow(index);
+    }
     std::string Print(uint16_t index) const;
 
+    // Host address of the code at index if it may be decoded ahead of time:
+    // ROM, WRAM and HRAM, or nullptr.
+    const byte* code_ptr(uint16_t index) const;
+    // Decoded code is watched for writes: its page loses its direct write
+    // pointer, and the first write to it calls the code write handler.
+    void WatchCode(uint16_t index);
+    void set_code_write_handler(std::function<void(const byte*, int)> f) {
+        _code_written = std::move(f);
+    }
+    // Changes whenever code may have changed, by a write or bank switch.
+    uint32_t code_version() const { return _code_version; }
+    // Offset of code in the ROM file, or -1 if it isn't ROM
+    int rom_offset(const byte* code) const;
+
+    // A write to 0xFF46 starts an OAM DMA of 160 M-cycles. Meanwhile, the CPU
+    // only reaches the 0xFF00 page, everything below reads 0xFF and ignores
+    // writes. The page is copied to OAM when the transfer completes.
+    static const int kDmaCycles = 160 * 4;
+    void FinishDma();
+
+    // What native code may access directly: the page tables, and HRAM which
+    // isn't in them.
+    struct PlainMemory {
+        const byte* const* read_pages;
+        byte* const* write_pages;
+        byte* hram;
+        // Set while HRAM holds watched code, which writes must invalidate
+        const bool* hram_watched;
+    };
+    PlainMemory plain_memory() {
+        return {_read_pages.data(), _write_pages.data(), &_hram[0].u,
+                &_code_pages[0xFF]};
+    }
+
+    void SaveState(StateWriter& w) const;
+    // Must come after the cartridge's, to map its current banks
+    void LoadState(StateReader& r);
+
    private:
     struct Addr {
         std::string _name;
@@ -37,6 +95,16 @@ class AddressBus {
     };
 
     const Addr& FindAddr(uint16_t) const;
+    void SetSlow(uint16_t index, Data8 val);
+    Data8 GetSlow(uint16_t index) const;
+
+    void MapPages(uint16_t begin, uint16_t end, const byte* r, byte* w);
+    // Rebuilds the page tables from the current banks, watched code and DMA
+    void MapMemory();
+    // Called after each MBC register write, which may switch banks or
+    // enable the cartridge RAM.
+    void MapCartridge();
+    void CodeWritten(int page);
 
     byte GetIntByte() const;
     Cartridge& _card;
@@ -45,10 +113,23 @@ class AddressBus {
     Keypad& _kp;
     Timer& _timer;
     Sound& _snd;
+    Interrupts& _ints;
+    Scheduler& _sched;
     std::array<Data8, 0xFFFF - 0xFF80> _hram;
     std::array<Data8, 0xE000 - 0xC000> _wram0;
 
-    byte _int_mask;
     std::vector<Addr> _mem_map;
-    mutable byte _interrupts;
+    bool _dma;
+    byte _dma_source;
+
+    // One entry per 256 bytes page, nullptr when the page needs a handler.
+    std::array<const byte*, 0x100> _read_pages;
+    std::array<byte*, 0x100> _write_pages;
+    // Handlers of the IO page, resolved once instead of searched each time.
+    std::array<const Addr*, 0x100> _io_ports;
+
+    // Pages holding watched code
+    std::array<bool, 0x100> _code_pages;
+    uint32_t _code_version;
+    std::function<void(const byte*, int)> _code_written;
 };
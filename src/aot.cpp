@@ -0,0 +1,35 @@
+#include "aot.h"
+
+#include <dlfcn.h>
+#include <cstring>
+#include <stdexcept>
+
+Aot::Aot(const std::string& filename)
+    : _handle(dlopen(filename.c_str(), RTLD_NOW | RTLD_LOCAL)) {
+    if (!_handle) {
+        throw std::runtime_error("Can't load " + filename + ": " + dlerror());
+    }
+    auto abi = static_cast<const int*>(dlsym(_handle, "gamulator_aot_abi"));
+    auto blocks =
+        static_cast<const Block*>(dlsym(_handle, "gamulator_aot_blocks"));
+    auto nb_blocks =
+        static_cast<const int*>(dlsym(_handle, "gamulator_aot_nb_blocks"));
+    if (!abi || *abi != kAbi || !blocks || !nb_blocks) {
+        dlclose(_handle);
+        throw std::runtime_error(filename + " wasn't made by this tools/aot.py");
+    }
+    for (int i = 0; i < *nb_blocks; ++i) {
+        _blocks[uint64_t(blocks[i].offset) << 16 | blocks[i].pc] = &blocks[i];
+    }
+}
+
+Aot::~Aot() { dlclose(_handle); }
+
+const Aot::Block* Aot::Find(int offset, uint16_t pc, const byte* code) const {
+    auto found = _blocks.find(uint64_t(offset) << 16 | pc);
+    if (found == _blocks.end() ||
+        std::memcmp(found->second->code, code, found->second->size) != 0) {
+        return nullptr;
+    }
+    return found->second;
+}
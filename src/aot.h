@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "addressbus.h"
+#include "blockcache.h"
+
+// Native code for one game, compiled ahead of time by tools/aot.py into a
+// shared object. Blocks are looked up by their offset in the ROM file and
+// the pc they run at, and only used if the ROM still holds the bytes they
+// were compiled from. They follow the same rules as the JIT's translations.
+class Aot {
+   public:
+    // Bumped whenever the interface with the compiled code changes
+    static const int kAbi = 1;
+
+    struct Block {
+        uint32_t offset;
+        uint16_t pc;
+        // The code it was compiled from
+        uint16_t size;
+        const byte* code;
+        // Cycles it may run before its last instruction starts
+        int span;
+        BlockCache::NativeCode run;
+    };
+
+    // Throws if filename can't be loaded or is for another ABI
+    explicit Aot(const std::string& filename);
+    ~Aot();
+
+    const Block* Find(int offset, uint16_t pc, const byte* code) const;
+
+   private:
+    void* _handle;
+    std::unordered_map<uint64_t, const Block*> _blocks;
+};
+
+// Helpers of the compiled code
+namespace aot {
+
+inline const byte* Read(const AddressBus::PlainMemory* m, unsigned addr) {
+    const byte* page = m->read_pages[addr >> 8];
+    return page ? page + (addr & 0xFF) : nullptr;
+}
+
+inline byte* Write(const AddressBus::PlainMemory* m, unsigned addr) {
+    byte* page = m->write_pages[addr >> 8];
+    return page ? page + (addr & 0xFF) : nullptr;
+}
+
+// 0xFF00 + n if it's HRAM, nullptr for IO
+inline byte* High(const AddressBus::PlainMemory* m, unsigned n, bool write) {
+    if (n < 0x80 || n == 0xFF || (write && *m->hram_watched)) {
+        return nullptr;
+    }
+    return m->hram + (n - 0x80);
+}
+
+inline unsigned Flags(unsigned z, unsigned n, unsigned h, unsigned c,
+                      unsigned f) {
+    return (z != 0) << 7 | (n != 0) << 6 | (h != 0) << 5 | (c != 0) << 4 |
+           (f & 0x0F);
+}
+
+}  // namespace aot
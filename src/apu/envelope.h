@@ -1,13 +1,18 @@
 #pragma once
 
-#include <atomic>
+#include <cstdint>
 
+#include "state.h"
 #include "utils.h"
 
 class Envelope {
    public:
     Envelope()
-        : _volume(15), _ascending(true), _samples_total(1), _samples(0) {}
+        : _volume(15),
+          _start_volume(15),
+          _ascending(true),
+          _samples_total(1),
+          _samples(0) {}
 
     void set_volume(byte x) { _start_volume = _volume = x & 0xf; }
     void set_direction(bool ascending) { _ascending = ascending; }
@@ -17,7 +22,22 @@ class Envelope {
 
     void Reset() {
         _samples = 0;
-        _volume = _start_volume.load();
+        _volume = _start_volume;
+    }
+
+    void SaveState(StateWriter& w) const {
+        w.Write(_volume);
+        w.Write(_start_volume);
+        w.Write(_ascending);
+        w.Write(_samples_total);
+        w.Write(_samples);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_volume);
+        r.Read(_start_volume);
+        r.Read(_ascending);
+        r.Read(_samples_total);
+        r.Read(_samples);
     }
 
    private:
@@ -29,9 +49,9 @@ class Envelope {
         return x * ((vol * 32767) / 15);
     }
 
-    std::atomic<int> _volume;
-    std::atomic<int> _start_volume;
-    std::atomic<bool> _ascending;
-    std::atomic<int> _samples_total;
-    std::atomic<int> _samples;
+    int _volume;
+    int _start_volume;
+    bool _ascending;
+    int _samples_total;
+    int _samples;
 };
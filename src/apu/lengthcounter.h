@@ -1,17 +1,21 @@
 #pragma once
 
-#include <atomic>
+#include <cstdint>
+
+#include "state.h"
 
 class LengthCounter {
    public:
+    LengthCounter() : _samples_to_play(0), _total_samples(0), _timed(false) {}
+
     void set_timed(bool cont) { _timed = cont; }
-    bool timed() const { return _timed.load(); }
+    bool timed() const { return _timed; }
 
     void set_len(int ms) {
         _total_samples = _samples_to_play = (ms * 44100) / 1000;
     }
 
-    void Reset() { _samples_to_play = _total_samples.load(); }
+    void Reset() { _samples_to_play = _total_samples; }
 
     void Process(int16_t* data, int n) {
         if (!_timed) {
@@ -28,8 +32,19 @@ class LengthCounter {
 
     bool ended() const { return _samples_to_play == 0; }
 
+    void SaveState(StateWriter& w) const {
+        w.Write(_samples_to_play);
+        w.Write(_total_samples);
+        w.Write(_timed);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_samples_to_play);
+        r.Read(_total_samples);
+        r.Read(_timed);
+    }
+
    private:
-    std::atomic<int> _samples_to_play;
-    std::atomic<int> _total_samples;
-    std::atomic<bool> _timed;
+    int _samples_to_play;
+    int _total_samples;
+    bool _timed;
 };
@@ -1,14 +1,15 @@
 #include "osc.h"
 
+#include <algorithm>
 #include <cassert>
 #include <limits>
 
-int16_t* Osc::GenSamples() {
+int16_t* Osc::GenSamples(int n) {
     if (_freq == 0) {
-        std::fill(_data.begin(), _data.end(), 0);
+        std::fill(_data.begin(), _data.begin() + n, 0);
         return &_data[0];
     }
-    for (unsigned int i = 0; i < _data.size(); ++i) {
+    for (int i = 0; i < n; ++i) {
         _freq = _sweep.Process();
         const int period_len = FreqToNbSamples(_freq);
         const int phase_len = GetPhaseLen(period_len);
@@ -47,7 +48,7 @@ int Sweep::Process() {
     }
 
     if (_count <= 0) {
-        _count = _sweep_count.load();
+        _count = _sweep_count;
 
         int n = _nb;
         if (_ascending) {
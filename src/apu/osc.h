@@ -1,6 +1,5 @@
 #pragma once
 
-#include <atomic>
 #include <cstdint>
 #include <vector>
 
@@ -8,7 +7,7 @@
 
 class Osc {
    public:
-    Osc(int samples) : _data(samples) {}
+    Osc(int samples) : _data(samples), _freq(0), _phase(0), _duty(0) {}
 
     int FreqToNbSamples(int freq) { return 44100 / freq; }
 
@@ -16,18 +15,33 @@ class Osc {
     int freq() const { return _freq; }
     void set_duty(int d) { _duty = d & 3; }
 
-    int16_t* GenSamples();
+    // Generates n samples, at most nb_samples()
+    int16_t* GenSamples(int n);
 
     int nb_samples() const { return _data.size(); }
 
     Sweep& sweep() { return _sweep; }
 
+    // _data is only scratch space for the samples being generated
+    void SaveState(StateWriter& w) const {
+        _sweep.SaveState(w);
+        w.Write(_freq);
+        w.Write(_phase);
+        w.Write(_duty);
+    }
+    void LoadState(StateReader& r) {
+        _sweep.LoadState(r);
+        r.Read(_freq);
+        r.Read(_phase);
+        r.Read(_duty);
+    }
+
    private:
     int GetPhaseLen(int period_len) const;
 
     Sweep _sweep;
     std::vector<int16_t> _data;
-    std::atomic<int> _freq;
-    std::atomic<int> _phase;
-    std::atomic<int> _duty;
+    int _freq;
+    int _phase;
+    int _duty;
 };
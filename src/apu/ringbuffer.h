@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Samples queue between the emulation, which writes, and the audio output,
+// which reads, each possibly from its own thread. Only the two positions
+// are shared.
+class RingBuffer {
+   public:
+    // size must be a power of two
+    RingBuffer(int size) : _data(size), _read(0), _write(0) {}
+
+    // Returns how many samples fit, the others are dropped.
+    int Push(const int16_t* src, int n) {
+        const uint64_t w = _write.load(std::memory_order_relaxed);
+        const uint64_t r = _read.load(std::memory_order_acquire);
+        n = std::min<int>(n, _data.size() - (w - r));
+        for (int i = 0; i < n; ++i) {
+            _data[(w + i) & (_data.size() - 1)] = src[i];
+        }
+        _write.store(w + n, std::memory_order_release);
+        return n;
+    }
+
+    // Returns how many samples were available.
+    int Pop(int16_t* dst, int n) {
+        const uint64_t r = _read.load(std::memory_order_relaxed);
+        const uint64_t w = _write.load(std::memory_order_acquire);
+        n = std::min<int>(n, w - r);
+        for (int i = 0; i < n; ++i) {
+            dst[i] = _data[(r + i) & (_data.size() - 1)];
+        }
+        _read.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+   private:
+    std::vector<int16_t> _data;
+    // Total counts of samples read and written
+    std::atomic<uint64_t> _read;
+    std::atomic<uint64_t> _write;
+};
@@ -4,24 +4,35 @@
 #include <vector>
 
 #include "chunk.h"
-#include "sdl.h"
+#include "frontend/frontend.h"
+#include "profiler.h"
+#include "ringbuffer.h"
+#include "scheduler.h"
+#include "state.h"
 #include "toneosc.h"
 #include "utils.h"
 #include "waveoutput.h"
 
-inline void InitAudio() { SDL_InitSubSystem(SDL_INIT_AUDIO); }
-
 class NoiseOsc {
    public:
-    NoiseOsc(int samples) : _data(samples), _rnd(53934) {}
+    NoiseOsc(int samples)
+        : _f(0),
+          _mode(0),
+          _wide(false),
+          _bit(false),
+          _rnd(53934),
+          _sample_cnt(0),
+          _sample_max(0),
+          _data(samples) {}
 
-    int16_t* GenSamples() {
+    // Generates n samples, at most nb_samples()
+    int16_t* GenSamples(int n) {
         if (_sample_max == 0) {
-            std::fill(_data.begin(), _data.end(), 0);
+            std::fill(_data.begin(), _data.begin() + n, 0);
             return &_data[0];
         }
 
-        for (unsigned int i = 0; i < _data.size(); ++i) {
+        for (int i = 0; i < n; ++i) {
             ++_sample_cnt;
             if (_sample_cnt >= _sample_max) {
                 _sample_cnt = 0;
@@ -51,6 +62,25 @@ class NoiseOsc {
 
     void Reset() { _rnd = 0x5f3b; }
 
+    void SaveState(StateWriter& w) const {
+        w.Write(_f);
+        w.Write(_mode);
+        w.Write(_wide);
+        w.Write(_bit);
+        w.Write(_rnd);
+        w.Write(_sample_cnt);
+        w.Write(_sample_max);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_f);
+        r.Read(_mode);
+        r.Read(_wide);
+        r.Read(_bit);
+        r.Read(_rnd);
+        r.Read(_sample_cnt);
+        r.Read(_sample_max);
+    }
+
    private:
     void UpdateSampleCount() {
         if (_mode == 0) {
@@ -72,8 +102,6 @@ class NoiseOsc {
 
     int _f;
     int _mode;
-    // std::atomic<int> _f;
-    // std::atomic<int> _mode;
     bool _wide;
     bool _bit;
     int _rnd;
@@ -84,7 +112,8 @@ class NoiseOsc {
 
 class Noise {
    public:
-    Noise(int samples) : _noise(samples) {}
+    Noise(int samples)
+        : _env_cache(0), _poly_cache(0), _consecutive_cache(0), _noise(samples) {}
     void set_len(byte x) {
         x &= 0x3F;
         _length.set_len((64 - x) * 1000 / 256);
@@ -119,13 +148,29 @@ class Noise {
     byte consecutive() const { return _consecutive_cache; }
 
     void Process(Chunk& c) {
-        c.samples = _noise.GenSamples();
-        c.sampleCount = _noise.nb_samples();
+        c.samples = _noise.GenSamples(c.sampleCount);
 
         _length.Process(c.samples, c.sampleCount);
         _env.Process(c.samples, c.sampleCount);
     }
 
+    void SaveState(StateWriter& w) const {
+        w.Write(_env_cache);
+        w.Write(_poly_cache);
+        w.Write(_consecutive_cache);
+        _length.SaveState(w);
+        _env.SaveState(w);
+        _noise.SaveState(w);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_env_cache);
+        r.Read(_poly_cache);
+        r.Read(_consecutive_cache);
+        _length.LoadState(r);
+        _env.LoadState(r);
+        _noise.LoadState(r);
+    }
+
    private:
     byte _env_cache;
     byte _poly_cache;
@@ -135,97 +180,162 @@ class Noise {
     NoiseOsc _noise;
 };
 
+// Samples are synthesized on the emulation thread, up to the current cycle,
+// before any register access and regularly from the APU event. Register
+// writes thus take effect at the exact sample they were made at, whatever
+// the emulation speed. The audio output only drains a ring buffer.
 class Sound {
    public:
-    Sound(bool mute = false)
-        : _mute(mute),
-          _nb_samples(2048),
-          _wav(_nb_samples),
-          _tone1(_nb_samples),
-          _tone2(_nb_samples),
-          _noise(_nb_samples) {
-        if (mute) {
-            return;
-        }
+    Sound(Scheduler& sched, AudioOutput& out)
+        : _sched(sched),
+          _out(out),
+          _synthesized(0),
+          _mixer(0),
+          _on_off(0),
+          _wav(kChunkSamples),
+          _tone1(kChunkSamples),
+          _tone2(kChunkSamples),
+          _noise(kChunkSamples),
+          _mix(kChunkSamples),
+          _ring(kRingSamples) {
+        _sched.Schedule(Scheduler::APU, CycleOfSample(kChunkSamples));
+        _out.Start([this](int16_t* samples, int nb_samples) {
+            Drain(samples, nb_samples);
+        });
+    }
+
+    // The accessors of the registers catch up first.
+    WaveOutput& wave() {
+        Sync();
+        return _wav;
+    }
+    Noise& noise() {
+        Sync();
+        return _noise;
+    }
+    ToneOsc& channel_1() {
+        Sync();
+        return _tone1;
+    }
+    ToneOsc& channel_2() {
+        Sync();
+        return _tone2;
+    }
 
-        SDL_AudioSpec spec;
+    void set_mixer(byte x) {
+        Sync();
+        _mixer = x;
+    }
 
-        SDL_memset(&spec, 0, sizeof(spec));
-        spec.freq = 44100;
-        spec.format = AUDIO_S16;
-        spec.channels = 1;
-        spec.samples = _nb_samples * 2;
-        spec.callback = Sound::_Run;
-        spec.userdata = this;
-        _dev = SDL_OpenAudioDevice(nullptr, 0, &spec, nullptr, 0);
-        std::cout << "DEV: " << _dev << " SAMPLES: " << spec.samples << "\n";
-        std::cout << SDL_GetError() << "\n";
-        SDL_PauseAudioDevice(_dev, 0);
+    byte on_off() const { return _on_off | 0x70; }
+    void set_on_off(byte x) {
+        Sync();
+        _on_off = x;
     }
 
-    WaveOutput& wave() { return _wav; }
-    Noise& noise() { return _noise; }
-    ToneOsc& channel_1() { return _tone1; }
-    ToneOsc& channel_2() { return _tone2; }
+    // Handles the APU event: synthesizes what's due and schedules the next
+    // chunk.
+    void Step() {
+        Sync();
+        _sched.Schedule(Scheduler::APU,
+                        CycleOfSample(_synthesized + kChunkSamples));
+    }
 
-    void set_mixer(byte x) { _mixer = x; }
+    ~Sound() { _out.Stop(); }
 
-    byte on_off() const { return _on_off | 0x70; }
-    void set_on_off(byte x) { _on_off = x; }
+    void SaveState(StateWriter& w) const {
+        w.Write(_synthesized);
+        w.Write(_mixer);
+        w.Write(_on_off);
+        _wav.SaveState(w);
+        _tone1.SaveState(w);
+        _tone2.SaveState(w);
+        _noise.SaveState(w);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_synthesized);
+        r.Read(_mixer);
+        r.Read(_on_off);
+        _wav.LoadState(r);
+        _tone1.LoadState(r);
+        _tone2.LoadState(r);
+        _noise.LoadState(r);
+    }
 
-    ~Sound() { SDL_CloseAudioDevice(_dev); }
+    static const int kSampleRate = 44100;
 
    private:
-    void Run(uint8_t* stream, int len) {
-        SDL_memset(stream, 0, len);
+    static const int kChunkSamples = 512;
+    // About 190ms, twice the SDL output's buffer
+    static const int kRingSamples = 8192;
+
+    // First cycle at which sample n is due
+    static uint64_t CycleOfSample(uint64_t n) {
+        return (n * kCpuFreq + kSampleRate - 1) / kSampleRate;
+    }
+
+    void Sync() {
+        const uint64_t due = _sched.now() * kSampleRate / kCpuFreq;
+        if (_synthesized >= due) {
+            return;
+        }
+        ProfileScope scope(Profiler::APU);
+        while (_synthesized < due) {
+            int n = std::min<uint64_t>(kChunkSamples, due - _synthesized);
+            RunChunk(n);
+            _synthesized += n;
+        }
+    }
+
+    // Called by the audio output, when it's late the samples are lost.
+    void Drain(int16_t* stream, int nb_samples) {
+        int n = _ring.Pop(stream, nb_samples);
+        std::fill(stream + n, stream + nb_samples, 0);
+    }
+
+    void RunChunk(int nb_samples) {
+        std::fill(_mix.begin(), _mix.begin() + nb_samples, 0);
+        int16_t* stream = &_mix[0];
 
         Chunk c;
-        c.sampleCount = len / 2;
+        c.sampleCount = nb_samples;
         _tone1.Process(c);
         if (GetBit(_mixer, 4) || GetBit(_mixer, 0)) {
-            SDL_MixAudioFormat(stream,
-                               reinterpret_cast<uint8_t*>(c.samples),
-                               AUDIO_S16,
-                               c.sampleCount * 2,
-                               SDL_MIX_MAXVOLUME);
+            Mix(stream, c.samples, nb_samples);
         }
         _tone2.Process(c);
         if (GetBit(_mixer, 4) || GetBit(_mixer, 1)) {
-            SDL_MixAudioFormat(stream,
-                               reinterpret_cast<uint8_t*>(c.samples),
-                               AUDIO_S16,
-                               c.sampleCount * 2,
-                               SDL_MIX_MAXVOLUME);
+            Mix(stream, c.samples, nb_samples);
         }
         _wav.Process(c);
         if (GetBit(_mixer, 6) || GetBit(_mixer, 2)) {
-            SDL_MixAudioFormat(stream,
-                               reinterpret_cast<uint8_t*>(c.samples),
-                               AUDIO_S16,
-                               c.sampleCount * 2,
-                               SDL_MIX_MAXVOLUME);
+            Mix(stream, c.samples, nb_samples);
         }
         _noise.Process(c);
         if (GetBit(_mixer, 7) || GetBit(_mixer, 3)) {
-            SDL_MixAudioFormat(stream,
-                               reinterpret_cast<uint8_t*>(c.samples),
-                               AUDIO_S16,
-                               c.sampleCount * 2,
-                               SDL_MIX_MAXVOLUME);
+            Mix(stream, c.samples, nb_samples);
         }
+        _ring.Push(stream, nb_samples);
     }
 
-    void static _Run(void* thisptr, uint8_t* stream, int len) {
-        static_cast<Sound*>(thisptr)->Run(stream, len);
+    // Adds src to dst, saturating
+    static void Mix(int16_t* dst, const int16_t* src, int nb_samples) {
+        for (int i = 0; i < nb_samples; ++i) {
+            int x = dst[i] + src[i];
+            dst[i] = std::max(-32768, std::min(32767, x));
+        }
     }
 
-    bool _mute;
-    int _nb_samples;
+    Scheduler& _sched;
+    AudioOutput& _out;
+    // Samples generated since power on
+    uint64_t _synthesized;
     byte _mixer;
     byte _on_off;
     WaveOutput _wav;
     ToneOsc _tone1;
     ToneOsc _tone2;
     Noise _noise;
-    SDL_AudioDeviceID _dev;
+    std::vector<int16_t> _mix;
+    RingBuffer _ring;
 };
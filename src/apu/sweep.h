@@ -1,10 +1,11 @@
 #pragma once
 
-#include <atomic>
+#include "state.h"
 
 class Sweep {
    public:
-    Sweep() : _nb(0) {}
+    Sweep()
+        : _sweep_count(0), _count(0), _f(0), _nb(0), _ascending(false) {}
     void set_time(int ms) { _count = _sweep_count = ms * 44100 / 1000; }
     void set_direction(bool increasing) { _ascending = increasing; }
     void set_nb_of_shifts(int n) { _nb = n; }
@@ -12,14 +13,29 @@ class Sweep {
     int Process();
 
     void Reset(int freq) {
-        _count = _sweep_count.load();
+        _count = _sweep_count;
         _f = freq;
     }
 
+    void SaveState(StateWriter& w) const {
+        w.Write(_sweep_count);
+        w.Write(_count);
+        w.Write(_f);
+        w.Write(_nb);
+        w.Write(_ascending);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_sweep_count);
+        r.Read(_count);
+        r.Read(_f);
+        r.Read(_nb);
+        r.Read(_ascending);
+    }
+
    private:
-    std::atomic<int> _sweep_count;
-    std::atomic<int> _count;
-    std::atomic<int> _f;
-    std::atomic<int> _nb;
-    std::atomic<bool> _ascending;
+    int _sweep_count;
+    int _count;
+    int _f;
+    int _nb;
+    bool _ascending;
 };
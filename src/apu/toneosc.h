@@ -9,7 +9,13 @@
 
 class ToneOsc {
    public:
-    ToneOsc(int samples) : _freq(440), _osc(samples) {}
+    ToneOsc(int samples)
+        : _freq(440),
+          _osc(samples),
+          _sweep_cache(0),
+          _len_pattern_cache(0),
+          _env_cache(0),
+          _freq_hi_cache(0) {}
 
     byte sweep() const { return 0x80 | _sweep_cache; }
     void set_sweep(byte x) {
@@ -56,8 +62,8 @@ class ToneOsc {
     }
 
     bool Process(Chunk& data) {
-        assert(data.sampleCount == _osc.nb_samples());
-        int16_t* buffer = _osc.GenSamples();
+        assert(data.sampleCount <= _osc.nb_samples());
+        int16_t* buffer = _osc.GenSamples(data.sampleCount);
 
         _length.Process(buffer, data.sampleCount);
         _env.Process(buffer, data.sampleCount);
@@ -66,6 +72,27 @@ class ToneOsc {
         return true;
     }
 
+    void SaveState(StateWriter& w) const {
+        w.Write(_freq);
+        _osc.SaveState(w);
+        _length.SaveState(w);
+        _env.SaveState(w);
+        w.Write(_sweep_cache);
+        w.Write(_len_pattern_cache);
+        w.Write(_env_cache);
+        w.Write(_freq_hi_cache);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_freq);
+        _osc.LoadState(r);
+        _length.LoadState(r);
+        _env.LoadState(r);
+        r.Read(_sweep_cache);
+        r.Read(_len_pattern_cache);
+        r.Read(_env_cache);
+        r.Read(_freq_hi_cache);
+    }
+
    private:
     void osc_set_freq() { _osc.set_freq(131072 / (2048 - _freq)); }
     void set_len(int val) { _length.set_len((64 - val) * 1000 / 256); }
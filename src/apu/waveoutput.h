@@ -6,7 +6,8 @@
 
 class WaveOutput {
    public:
-    WaveOutput(int samples) : _wav(samples) {}
+    WaveOutput(int samples)
+        : _wav(samples), _freq(0), _level(0), _hi_cache(0) {}
 
     void set_active(byte x) { _wav.set_active((x & (1 << 7)) != 0); }
     bool active() const { return _wav.active() << 7; }
@@ -39,16 +40,29 @@ class WaveOutput {
     byte Read(uint16_t addr) const { return _wav.Read(addr); }
 
     bool Process(Chunk& data) {
-        int16_t* buffer = _wav.GenSamples();
-        int nb = _wav.nb_samples();
+        int16_t* buffer = _wav.GenSamples(data.sampleCount);
 
-        _length.Process(buffer, nb);
+        _length.Process(buffer, data.sampleCount);
 
         data.samples = buffer;
-        data.sampleCount = nb;
         return true;
     }
 
+    void SaveState(StateWriter& w) const {
+        _wav.SaveState(w);
+        _length.SaveState(w);
+        w.Write(_freq);
+        w.Write(_level);
+        w.Write(_hi_cache);
+    }
+    void LoadState(StateReader& r) {
+        _wav.LoadState(r);
+        _length.LoadState(r);
+        r.Read(_freq);
+        r.Read(_level);
+        r.Read(_hi_cache);
+    }
+
    private:
     void wav_set_freq() { _wav.set_freq(65536 / (2048 - _freq)); }
 
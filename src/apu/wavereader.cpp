@@ -1,12 +1,12 @@
 #include "wavereader.h"
 
-int16_t* WaveReader::GenSamples() {
+int16_t* WaveReader::GenSamples(int n) {
     if (!_active) {
-        std::fill(_cache.begin(), _cache.end(), 0);
+        std::fill(_cache.begin(), _cache.begin() + n, 0);
         return &_cache[0];
     }
 
-    for (unsigned int i = 0; i < _cache.size(); ++i) {
+    for (int i = 0; i < n; ++i) {
         _cache[i] =
             AdjustLevel(NibbleToInt16(NthNibble(_cursor * _data.size() * 2)));
         _cursor += _freq / 44100.;
@@ -5,13 +5,18 @@
 #include <limits>
 #include <vector>
 
+#include "state.h"
 #include "utils.h"
 
 class WaveReader {
    public:
-    WaveReader(int samples) : _active(true), _freq(440), _cache(samples) {}
+    WaveReader(int samples)
+        : _cursor(0), _active(true), _freq(440), _level(0), _cache(samples) {
+        _data.fill(0);
+    }
 
-    int16_t* GenSamples();
+    // Generates n samples, at most nb_samples()
+    int16_t* GenSamples(int n);
 
     int nb_samples() const { return _cache.size(); }
 
@@ -24,6 +29,21 @@ class WaveReader {
     void set_active(bool b) { _active = b; }
     bool active() const { return _active; }
 
+    void SaveState(StateWriter& w) const {
+        w.Write(_cursor);
+        w.Write(_active);
+        w.Write(_freq);
+        w.Write(_level);
+        w.Write(_data);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_cursor);
+        r.Read(_active);
+        r.Read(_freq);
+        r.Read(_level);
+        r.Read(_data);
+    }
+
    private:
     byte NthNibble(int16_t n) const {
         byte b = _data[n / 2];
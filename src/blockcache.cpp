@@ -0,0 +1,142 @@
+#include "blockcache.h"
+
+#include <algorithm>
+
+#include "addressbus.h"
+#include "aot.h"
+#include "z80.h"
+
+void BlockCache::set_aot(const Aot* aot) {
+    _aot = aot;
+    for (auto& block : _blocks) {
+        BindAot(block.first, block.second);
+    }
+}
+
+BlockCache::Block* BlockCache::Find(uint16_t pc) {
+    const byte* code = _addr.code_ptr(pc);
+    if (!code) {
+        return nullptr;
+    }
+    auto found = _blocks.equal_range(code);
+    for (auto it = found.first; it != found.second; ++it) {
+        if (it->second.ops[0].pc == pc) {
+            return &it->second;
+        }
+    }
+
+    // 0xFFFF is IE, not HRAM
+    const int end = std::min((pc | 0xFF) + 1, 0xFFFF);
+    Block block;
+    int at = pc;
+    while (at < end) {
+        byte op = code[at - pc];
+        int len = Z80::length(op);
+        if (at + len > end) {
+            break;  // its operand is in the next page
+        }
+
+        Op decoded;
+        decoded.run = Z80::handler(op);
+        decoded.pc = at;
+        decoded.opcode = op;
+        if (len > 1) {
+            decoded.imm.bytes.l.u = code[at - pc + 1];
+        }
+        if (len > 2) {
+            decoded.imm.bytes.h.u = code[at - pc + 2];
+        }
+        block.ops.push_back(decoded);
+
+        at += len;
+        if (EndsBlock(op)) {
+            break;
+        }
+    }
+    if (block.ops.empty()) {
+        return nullptr;
+    }
+
+    _addr.WatchCode(pc);
+    BindAot(code, block);
+    return &_blocks.emplace(code, std::move(block))->second;
+}
+
+void BlockCache::Invalidate(const byte* code, int size) {
+    for (int i = 0; i < size; ++i) {
+        _blocks.erase(code + i);
+    }
+}
+
+void BlockCache::ForgetNative() {
+    for (auto& block : _blocks) {
+        block.second.runs = 0;
+        BindAot(block.first, block.second);
+    }
+}
+
+std::vector<std::pair<int, uint16_t>> BlockCache::RomCoverage() const {
+    std::vector<std::pair<int, uint16_t>> blocks;
+    for (const auto& block : _blocks) {
+        int offset = _addr.rom_offset(block.first);
+        if (offset >= 0) {
+            blocks.emplace_back(offset, block.second.ops[0].pc);
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+    return blocks;
+}
+
+void BlockCache::BindAot(const byte* code, Block& block) const {
+    block.native = nullptr;
+    if (!_aot) {
+        return;
+    }
+    int offset = _addr.rom_offset(code);
+    const Aot::Block* compiled =
+        offset >= 0 ? _aot->Find(offset, block.ops[0].pc, code) : nullptr;
+    if (compiled) {
+        block.native = compiled->run;
+        block.native_span = compiled->span;
+    }
+}
+
+bool BlockCache::EndsBlock(byte op) {
+    switch (op) {
+        case 0x10:  // stop
+        case 0x18:  // jr
+        case 0x20:
+        case 0x28:
+        case 0x30:
+        case 0x38:
+        case 0x76:  // halt
+        case 0xC0:  // ret
+        case 0xC8:
+        case 0xC9:
+        case 0xD0:
+        case 0xD8:
+        case 0xD9:  // reti
+        case 0xC2:  // jp
+        case 0xC3:
+        case 0xCA:
+        case 0xD2:
+        case 0xDA:
+        case 0xE9:
+        case 0xC4:  // call
+        case 0xCC:
+        case 0xCD:
+        case 0xD4:
+        case 0xDC:
+        case 0xC7:  // rst
+        case 0xCF:
+        case 0xD7:
+        case 0xDF:
+        case 0xE7:
+        case 0xEF:
+        case 0xF7:
+        case 0xFF:
+            return true;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "addressbus.h"
+#include "utils.h"
+
+class Aot;
+class Z80;
+
+// Straight-line runs of instructions, decoded once into their handler and
+// immediate operand. Blocks are keyed by the host address of their first
+// byte, which tells ROM banks apart, and by their pc since the same bank can
+// be mapped at two addresses. They never span two 256 bytes pages of the bus
+// so that a page (re)mapping or write covers whole blocks.
+class BlockCache {
+   public:
+    struct Op {
+        int (*run)(Z80*);
+        Data16 imm;
+        uint16_t pc;
+        byte opcode;
+    };
+
+    // Where native code stopped: pc and instructions run.
+    struct NativeExit {
+        uint32_t pc;
+        uint32_t instructions;
+    };
+    // Runs on the registers of the Z80 and returns the cycles taken
+    typedef int (*NativeCode)(Data8* regs,
+                              NativeExit* exit,
+                              const AddressBus::PlainMemory* mem);
+
+    struct Block {
+        std::vector<Op> ops;
+        // Runs from the first instruction, to find the hot blocks
+        int runs = 0;
+        // Translation of the block or of its first instructions, see Jit
+        // and Aot
+        NativeCode native = nullptr;
+        // Cycles native code may run before its last instruction starts
+        int native_span = 0;
+    };
+
+    BlockCache(AddressBus& addr) : _addr(addr), _aot(nullptr) {}
+
+    // Blocks compiled ahead of time are bound to native code when decoded
+    void set_aot(const Aot* aot);
+
+    // Returns the block starting at pc, decoding it on first use, or nullptr
+    // if the code there can't be cached.
+    Block* Find(uint16_t pc);
+
+    // Drops the blocks decoded from the size bytes starting at code.
+    void Invalidate(const byte* code, int size);
+    // Drops all native code but the ahead of time one, when the JIT runs
+    // out of space
+    void ForgetNative();
+
+    // ROM offset and pc of the blocks decoded from ROM so far
+    std::vector<std::pair<int, uint16_t>> RomCoverage() const;
+
+   private:
+    static bool EndsBlock(byte op);
+    void BindAot(const byte* code, Block& block) const;
+
+    AddressBus& _addr;
+    std::unordered_multimap<const byte*, Block> _blocks;
+    const Aot* _aot;
+};
@@ -9,6 +9,7 @@
  */
 
 #include <algorithm>
+#include <ctime>
 #include <iostream>
 #include <stdexcept>
 
@@ -16,399 +17,498 @@
 #include "utils.h"
 #include "z80.h"
 
-void Error(uint16_t idx) {
-    throw std::runtime_error("Invalid access at " + hex(idx));
-}
-
-class Raw : public Cartridge::Controller {
+class Raw final : public Cartridge::Controller {
    public:
-    Raw(std::vector<byte>&& data)
-        : Cartridge::Controller(std::move(data), 0xC000 - 0xA000) {
-        _mem_map = {
-            {"rom_bank_0",
-             0x0000,
-             0x3FFF,
-             [&](uint16_t idx) { return Rom(idx); },
-             [&](uint16_t, byte) {
-                 cerror << "Can't switch ROM bank without MBC\n";
-             }},
-            {"rom_bank_switchable",
-             0x4000,
-             0x7FFF,
-             [&](uint16_t idx) { return Rom(idx); },
-             [&](uint16_t, byte) {
-                 cerror << "Can't switch ROM bank without MBC\n";
-             }},
-            {"ram_bank",
-             0xA000,
-             0xBFFF,
-             [&](uint16_t idx) { return Ram(idx - 0xA000); },
-             [&](uint16_t idx, byte b) { Ram(idx - 0xA000) = b; }},
-        };
+    Raw(std::shared_ptr<const RomFile> rom, int ram_size)
+        : Cartridge::Controller(std::move(rom), ram_size) {
+        SelectBanks(0, 1, 0);
+    }
+
+   protected:
+    void WriteRegister(uint16_t idx, byte) override {
+        if (idx < 0x8000) {
+            cerror << "Can't switch ROM bank without MBC\n";
+        }
     }
 };
 
-class MBC1 : public Cartridge::Controller {
+class MBC1 final : public Cartridge::Controller {
    public:
-    MBC1(std::vector<byte>&& data)
-        : Cartridge::Controller(std::move(data), 4 * 0x2000),
+    MBC1(std::shared_ptr<const RomFile> rom,
+         int ram_size,
+         const std::string& save)
+        : Cartridge::Controller(std::move(rom), ram_size, save),
           _lo(1),
           _hi(0),
           _selector(RamRomSelector::Rom),
           _ram_enable(false) {
-        _mem_map = {{"rom_bank_0",
-                     0x0000,
-                     0x1FFF,
-                     [&](uint16_t idx) {
-                         if (_selector == RamRomSelector::Rom) {
-                             return Rom(idx);
-                         } else {
-                             return Rom(idx + (rom_bank() & 0xE0) * 0x4000);
-                         }
-                     },
-                     [&](uint16_t, byte x) { _ram_enable = (x & 0xF) == 0xA; }},
-                    {"rom_bank_0/low_bits",
-                     0x2000,
-                     0x3FFF,
-                     [&](uint16_t idx) {
-                         if (_selector == RamRomSelector::Rom) {
-                             return Rom(idx);
-                         } else {
-                             return Rom(idx + (rom_bank() & 0xE0) * 0x4000);
-                         }
-                     },
-                     [&](uint16_t, byte b) {
-                         b = b & 0b1'1111;
-                         b = (b == 0) ? 1 : b;
-                         _lo = b;
-                     }},
-                    {"rom_bank_switchable/high_bits",
-                     0x4000,
-                     0x5FFF,
-                     [&](uint16_t idx) {
-                         return Rom(idx - 0x4000 + rom_bank() * 0x4000);
-                     },
-                     [&](uint16_t, byte b) { _hi = b & 3; }},
-                    {"rom_bank_switchable/ram_rom_select",
-                     0x6000,
-                     0x7FFF,
-                     [&](uint16_t idx) {
-                         return Rom(idx - 0x4000 + rom_bank() * 0x4000);
-                     },
-                     [&](uint16_t, byte b) {
-                         _selector = RamRomSelector(b & 1);
-                         _hi = 0;
-                     }},
-                    {"cartridge_ram",
-                     0xA000,
-                     0xBFFF,
-                     [&](uint16_t idx) -> byte {
-                         if (!_ram_enable) {
-                             return 0xFF;
-                         }
-
-                         return Ram((idx - 0xA000) + ram_bank() * 0x2000);
-                     },
-                     [&](uint16_t idx, byte b) {
-                         if (!_ram_enable) {
-                             return;
-                         }
-
-                         Ram((idx - 0xA000) + ram_bank() * 0x2000) = b;
-                     }}};
+        MapBanks();
+    }
+
+    void SaveState(StateWriter& w) const override {
+        Controller::SaveState(w);
+        w.Write(_lo);
+        w.Write(_hi);
+        w.Write(_selector);
+        w.Write(_ram_enable);
+    }
+    void LoadState(StateReader& r) override {
+        Controller::LoadState(r);
+        r.Read(_lo);
+        r.Read(_hi);
+        r.Read(_selector);
+        r.Read(_ram_enable);
+        MapBanks();
+    }
+
+   protected:
+    // Writes to the disabled RAM are ignored
+    void WriteRegister(uint16_t idx, byte b) override {
+        if (idx < 0x2000) {
+            if (_ram_enable && (b & 0xF) != 0xA) {
+                FlushRam();
+            }
+            _ram_enable = (b & 0xF) == 0xA;
+        } else if (idx < 0x4000) {
+            b = b & 0b1'1111;
+            _lo = (b == 0) ? 1 : b;
+        } else if (idx < 0x6000) {
+            _hi = b & 3;
+        } else if (idx < 0x8000) {
+            _selector = RamRomSelector(b & 1);
+            _hi = 0;
+        } else {
+            return;
+        }
+        MapBanks();
     }
 
    private:
-    int ram_bank() const {
+    // In RAM mode, the high bits select the RAM bank and the ROM bank at
+    // 0x0000 too.
+    void MapBanks() {
+        const int bank = ((_hi << 5) | _lo) & (rom_banks() - 1);
         if (_selector == RamRomSelector::Rom) {
-            return 0;
+            SelectBanks(0, bank, _ram_enable ? 0 : -1);
         } else {
-            return _hi;
+            SelectBanks(bank & 0xE0, bank, _ram_enable ? _hi : -1);
         }
     }
 
-    int rom_bank() const { return ((_hi << 5) | _lo) & (rom_banks() - 1); }
-
     byte _lo;
     byte _hi;
     enum class RamRomSelector { Rom = 0, Ram = 1 } _selector;
     bool _ram_enable;
 };
 
-class MBC3 : public Cartridge::Controller {
+class MBC3 final : public Cartridge::Controller {
    public:
-    MBC3(std::vector<byte>&& data)
-        : Cartridge::Controller(std::move(data), 4 * 0x2000 + 48),
-          _rtc_select(RTCSelect::None),
-          _rom_nbr(1) {
-        _mem_map = {{"rom_bank_0",
-                     0x0000,
-                     0x1FFF,
-                     [&](uint16_t idx) { return Rom(idx); },
-                     [&](uint16_t, byte) {
-                         std::cout << "RAM/Timer enable not implmented\n";
-                     }},
-                    {"rom_bank_0",
-                     0x2000,
-                     0x3FFF,
-                     [&](uint16_t idx) { return Rom(idx); },
-                     [&](uint16_t, byte b) { _rom_nbr = (b == 0 ? 1 : b); }},
-                    {"rom_bank_switchable",
-                     0x4000,
-                     0x5FFF,
-                     [&](uint16_t idx) {
-                         return Rom(idx - 0x4000 + _rom_nbr * 0x4000);
-                     },
-                     [&](uint16_t, byte b) {
-                         if (b < 8) {
-                             _ram_nbr = b & 0b11;
-                             _rtc_select = RTCSelect::None;
-                         } else {
-                             std::cout << "RTC SELECT: " << int(b) << "\n";
-                             _rtc_select = RTCSelect(b);
-                         }
-                     }},
-                    {"rom_bank_switchable",
-                     0x6000,
-                     0x7FFF,
-                     [&](uint16_t idx) {
-                         return Rom(idx - 0x4000 + _rom_nbr * 0x4000);
-                     },
-                     [&](uint16_t, byte x) {
-                         std::cout << "RTC LATCH: " << int(x) << "\n";
-                     }},
-                    {
-                        "cartridge_ram",
-                        0xA000,
-                        0xBFFF,
-                        [&](uint16_t idx) -> byte {
-                            if (_rtc_select == RTCSelect::None) {
-                                return Ram((idx - 0xA000) + _ram_nbr * 0x2000);
-                            } else {
-                                std::cout << "READ RTC\n";
-                                std::time_t now = std::time(nullptr);
-                                std::tm* time = std::localtime(&now);
-                                switch (_rtc_select) {
-                                    case RTCSelect::Sec:
-                                        return time->tm_sec;
-                                    case RTCSelect::Min:
-                                        return time->tm_min;
-                                    case RTCSelect::Hour:
-                                        return time->tm_hour;
-                                    case RTCSelect::DayLow:
-                                        return time->tm_mday & 0xFF;
-                                    case RTCSelect::DayHigh:
-                                        return GetBit(time->tm_mday, 9);
-                                    default:
-                                        return 0xFF;
-                                }
-                            }
-                        },
-                        [&](uint16_t idx, byte b) {
-                            if (_rtc_select == RTCSelect::None) {
-                                Ram((idx - 0xA000) + _ram_nbr * 0x2000) = b;
-                            } else {
-                                std::cout << "RTC NOT IMPLEMENTED\n";
-                                switch (_rtc_select) {
-                                    case RTCSelect::Sec:
-                                    case RTCSelect::Min:
-                                    case RTCSelect::Hour:
-                                    case RTCSelect::DayLow:
-                                    case RTCSelect::DayHigh:
-                                    default:
-                                        return;
-                                }
-                            }
-                        },
-
-                    }};
+    // The clock is saved after the RAM
+    MBC3(std::shared_ptr<const RomFile> rom,
+         int ram_size,
+         const std::string& save,
+         const Scheduler& sched)
+        : Cartridge::Controller(std::move(rom), ram_size + sizeof(RTC), save),
+          _rtc_select(0),
+          _rom_nbr(1),
+          _ram_nbr(0),
+          _sched(sched),
+          _rtc_synced(sched.now()),
+          _latch(0xFF),
+          _wall_clock(false),
+          _ram_enable(false) {
+        MapBanks();
+    }
+    ~MBC3() {
+        if (_wall_clock) {
+            SyncRtc();
+        }
+    }
+
+    // The time spent since the clock was saved is added, and from now on the
+    // saved time is kept for the next run.
+    void UseWallClock() override {
+        SyncRtc();
+        RTC& rtc = GetRTC();
+        const int64_t now = std::time(nullptr);
+        if (!(rtc.regs[kDayHigh] & kHalt) && rtc.timestamp > 0 &&
+            now > rtc.timestamp) {
+            Advance(now - rtc.timestamp);
+        }
+        rtc.timestamp = now;
+        _wall_clock = true;
+    }
+
+    void SaveState(StateWriter& w) const override {
+        Controller::SaveState(w);
+        w.Write(_rtc_select);
+        w.Write(_rom_nbr);
+        w.Write(_ram_nbr);
+        w.Write(_rtc_synced);
+        w.Write(_latch);
+        w.Write(_ram_enable);
+    }
+    void LoadState(StateReader& r) override {
+        Controller::LoadState(r);
+        r.Read(_rtc_select);
+        r.Read(_rom_nbr);
+        r.Read(_ram_nbr);
+        r.Read(_rtc_synced);
+        r.Read(_latch);
+        r.Read(_ram_enable);
+        MapBanks();
+    }
+
+   protected:
+    // Clock registers read their latched value
+    byte ReadRam(uint16_t) const override {
+        const int reg = _rtc_select - 8;
+        if (reg < 0 || reg >= kNbRegs) {
+            return 0xFF;
+        }
+        return GetRTC().latched[reg];
+    }
+
+    void WriteRegister(uint16_t idx, byte b) override {
+        if (idx < 0x2000) {
+            if (_ram_enable && (b & 0xF) != 0xA) {
+                FlushRam();
+            }
+            _ram_enable = (b & 0xF) == 0xA;
+        } else if (idx < 0x4000) {
+            _rom_nbr = (b == 0 ? 1 : b);
+            MapBanks();
+        } else if (idx < 0x6000) {
+            if (b < 8) {
+                _ram_nbr = b & 0b11;
+                _rtc_select = 0;
+            } else {
+                _rtc_select = b;
+            }
+            MapBanks();
+        } else if (idx < 0x8000) {
+            // Writing 0 then 1 latches the clock
+            if (_latch == 0 && b == 1) {
+                SyncRtc();
+                RTC& rtc = GetRTC();
+                std::copy(rtc.regs, rtc.regs + kNbRegs, rtc.latched);
+            }
+            _latch = b;
+        } else {
+            WriteRtc(b);
+        }
     }
 
    private:
-    struct RTCRegs {
-        int secs;
-        int mins;
-        int hours;
-        int days;
-        int days_high;
-        int secs_latch;
-        int mins_latch;
-        int hours_latch;
-        int days_latch;
-        int days_high_latch;
-        int timestamp;
-        int dummy;
+    enum { kSec, kMin, kHour, kDayLow, kDayHigh, kNbRegs };
+    // Bits of the day high register
+    static const byte kDay8 = 0x01;
+    static const byte kHalt = 0x40;
+    static const byte kDayCarry = 0x80;
+
+    // How other emulators save the clock: the registers, their latched
+    // values, and the UNIX time the registers were up to date at.
+    struct RTC {
+        uint32_t regs[kNbRegs];
+        uint32_t latched[kNbRegs];
+        int64_t timestamp;
     };
 
-    MBC3::RTCRegs& GetRTC() {
-        return reinterpret_cast<RTCRegs&>(Ram(4 * 0x2000));
+    RTC& GetRTC() {
+        return reinterpret_cast<RTC&>(Ram(ram_size() - sizeof(RTC)));
+    }
+    const RTC& GetRTC() const {
+        return const_cast<MBC3*>(this)->GetRTC();
     }
 
-    enum class RTCSelect {
-        None = 0,
-        Sec = 0x8,
-        Min = 0x9,
-        Hour = 0xA,
-        DayLow = 0xB,
-        DayHigh = 0xC
-    };
+    // The clock registers are read through ReadRam
+    void MapBanks() {
+        SelectBanks(0, _rom_nbr, _rtc_select ? -1 : _ram_nbr);
+    }
+
+    void WriteRtc(byte b) {
+        static const byte masks[kNbRegs] = {0x3F, 0x3F, 0x1F, 0xFF, 0xC1};
+        const int reg = _rtc_select - 8;
+        if (reg < 0 || reg >= kNbRegs) {
+            return;
+        }
+        SyncRtc();
+        // Writing the seconds restarts the current one
+        if (reg == kSec) {
+            _rtc_synced = _sched.now();
+        }
+        GetRTC().regs[reg] = b & masks[reg];
+    }
+
+    // Counts the whole seconds elapsed on the machine clock
+    void SyncRtc() {
+        RTC& rtc = GetRTC();
+        const uint64_t now = _sched.now();
+        if (rtc.regs[kDayHigh] & kHalt) {
+            _rtc_synced = now;
+        } else {
+            const uint64_t secs = (now - _rtc_synced) / kCpuFreq;
+            _rtc_synced += secs * kCpuFreq;
+            Advance(secs);
+        }
+        if (_wall_clock) {
+            rtc.timestamp = std::time(nullptr);
+        }
+    }
+
+    // One second, as the hardware counts it: out of range values go up to
+    // their bits' limit and wrap without carry.
+    void Tick() {
+        uint32_t* regs = GetRTC().regs;
+        regs[kSec] = (regs[kSec] + 1) & 0x3F;
+        if (regs[kSec] != 60) {
+            return;
+        }
+        regs[kSec] = 0;
+        regs[kMin] = (regs[kMin] + 1) & 0x3F;
+        if (regs[kMin] != 60) {
+            return;
+        }
+        regs[kMin] = 0;
+        regs[kHour] = (regs[kHour] + 1) & 0x1F;
+        if (regs[kHour] != 24) {
+            return;
+        }
+        regs[kHour] = 0;
+        AddDays(1);
+    }
+
+    // The day counter has 9 bits, its overflow sets the carry until cleared
+    void AddDays(uint64_t n) {
+        uint32_t* regs = GetRTC().regs;
+        uint64_t days = ((regs[kDayHigh] & kDay8) << 8 | regs[kDayLow]) + n;
+        if (days > 0x1FF) {
+            regs[kDayHigh] |= kDayCarry;
+        }
+        regs[kDayLow] = days & 0xFF;
+        regs[kDayHigh] = (regs[kDayHigh] & ~kDay8) | ((days >> 8) & kDay8);
+    }
+
+    void Advance(uint64_t secs) {
+        uint32_t* regs = GetRTC().regs;
+        while (secs > 0 &&
+               (regs[kSec] >= 60 || regs[kMin] >= 60 || regs[kHour] >= 24)) {
+            Tick();
+            --secs;
+        }
+        if (secs == 0) {
+            return;
+        }
+        const uint64_t t =
+            regs[kSec] + 60 * (regs[kMin] + 60 * uint64_t(regs[kHour])) + secs;
+        regs[kSec] = t % 60;
+        regs[kMin] = t / 60 % 60;
+        regs[kHour] = t / 3600 % 24;
+        AddDays(t / 86400);
+    }
 
-    RTCSelect _rtc_select;
+    // 0 for RAM, 0x8-0xC for a clock register
+    byte _rtc_select;
     byte _rom_nbr;
     byte _ram_nbr;
+    const Scheduler& _sched;
+    // Cycle the clock registers are up to date with, to the second
+    uint64_t _rtc_synced;
+    // Last value written to 0x6000-0x7FFF
+    byte _latch;
+    bool _wall_clock;
+    // Disabling the RAM flushes it to the save file
+    bool _ram_enable;
 };
 
-class MBC5 : public Cartridge::Controller {
+class MBC5 final : public Cartridge::Controller {
    public:
-    MBC5(std::vector<byte>&& data)
-        : Cartridge::Controller(std::move(data), 0x80 * 0x2000), _rom_nbr(1) {
-        _mem_map = {
-            {"rom_bank_0",
-             0x0000,
-             0x1FFF,
-             [&](uint16_t idx) { return Rom(idx); },
-             [&](uint16_t, byte) {
-                 std::cout << "RAM/Timer enable not implmented\n";
-             }},
-            {"rom_bank_0",
-             0x2000,
-             0x2FFF,
-             [&](uint16_t idx) { return Rom(idx); },
-             [&](uint16_t, byte b) { _rom_nbr = (_rom_nbr & ~(1 << 9)) | b; }},
-            {"rom_bank_0",
-             0x3000,
-             0x3FFF,
-             [&](uint16_t idx) { return Rom(idx); },
-             [&](uint16_t, byte idx) {
-                 _rom_nbr = (_rom_nbr & 0xff) | ((idx & 1) << 9);
-             }},
-            {"rom_bank_switchable",
-             0x4000,
-             0x5FFF,
-             [&](uint16_t idx) {
-                 return Rom(idx - 0x4000 + _rom_nbr * 0x4000);
-             },
-             [&](uint16_t, byte b) { _ram_nbr = b & 0xf; }},
-            {"rom_bank_switchable",
-             0x6000,
-             0x7FFF,
-             [&](uint16_t idx) {
-                 return Rom(idx - 0x4000 + _rom_nbr * 0x4000);
-             },
-             [&](uint16_t, byte) { std::cout << "RTC not implemented\n"; }},
-            {
-                "cartridge_ram",
-                0xA000,
-                0xBFFF,
-                [&](uint16_t idx) {
-                    return Ram((idx - 0xA000) + _ram_nbr * 0x2000);
-                },
-                [&](uint16_t idx, byte b) {
-                    Ram((idx - 0xA000) + _ram_nbr * 0x2000) = b;
-                },
-
-            }};
+    MBC5(std::shared_ptr<const RomFile> rom,
+         int ram_size,
+         const std::string& save)
+        : Cartridge::Controller(std::move(rom), ram_size, save),
+          _rom_nbr(1),
+          _ram_nbr(0),
+          _ram_enable(false) {
+        MapBanks();
+    }
+
+    void SaveState(StateWriter& w) const override {
+        Controller::SaveState(w);
+        w.Write(_rom_nbr);
+        w.Write(_ram_nbr);
+        w.Write(_ram_enable);
+    }
+    void LoadState(StateReader& r) override {
+        Controller::LoadState(r);
+        r.Read(_rom_nbr);
+        r.Read(_ram_nbr);
+        r.Read(_ram_enable);
+        MapBanks();
+    }
+
+   protected:
+    // There is no register at 0x6000-0x7FFF
+    void WriteRegister(uint16_t idx, byte b) override {
+        if (idx < 0x2000) {
+            if (_ram_enable && (b & 0xF) != 0xA) {
+                FlushRam();
+            }
+            _ram_enable = (b & 0xF) == 0xA;
+        } else if (idx < 0x3000) {
+            _rom_nbr = (_rom_nbr & 0x100) | b;
+            MapBanks();
+        } else if (idx < 0x4000) {
+            _rom_nbr = (_rom_nbr & 0xFF) | ((b & 1) << 8);
+            MapBanks();
+        } else if (idx < 0x6000) {
+            _ram_nbr = b & 0xf;
+            MapBanks();
+        }
     }
 
    private:
+    void MapBanks() { SelectBanks(0, _rom_nbr, _ram_nbr); }
+
     int _rom_nbr;
     byte _ram_nbr;
+    // Games disable the RAM once done saving
+    bool _ram_enable;
 };
 
-std::vector<byte> Cartridge::LoadGame(const std::string& filename) {
-    std::vector<byte> data;
-    std::ifstream file(filename, std::ios::in | std::ios::binary);
-    while (true) {
-        auto x = file.get();
-        if (!file.good()) {
-            break;
-        }
-        data.push_back(x);
+// Decodes the RAM size byte of the header. The 2 KB of type 1 still take a
+// whole bank.
+static int RamSize(byte type) {
+    switch (type) {
+        case 0x01:
+        case 0x02:
+            return 0x2000;
+        case 0x03:
+            return 4 * 0x2000;
+        case 0x04:
+            return 16 * 0x2000;
+        case 0x05:
+            return 8 * 0x2000;
+        default:
+            return 0;
     }
-    return data;
 }
 
-Cartridge::Cartridge(std::string filename) : _has_battery(false) {
-    auto data = LoadGame(filename);
-    _game_name = std::string(reinterpret_cast<char*>(&data[0x134]));
+Cartridge::Cartridge(std::string filename, const Scheduler& sched) {
+    auto rom = RomFile::Load(filename);
+    const byte* data = rom->data();
+    _game_name = std::string(reinterpret_cast<const char*>(&data[0x134]));
     std::replace(_game_name.begin(), _game_name.end(), ' ', '_');
 
-    std::cout << "Game is " << _game_name << " size=" << std::hex << data.size()
+    std::cout << "Game is " << _game_name << " size=" << std::hex << rom->size()
               << std::endl;
     int mbc = data[0x147];
     std::cout << "CARTRIDGE TYPE: " << std::hex << int(mbc) << "\n";
+    int ram_size = RamSize(data[0x149]);
 
+    const std::string save = _game_name + ".save";
     switch (mbc) {
         case 0x00:
-            _ctrl = std::make_unique<Raw>(std::move(data));
+            _ctrl = std::make_unique<Raw>(std::move(rom), ram_size);
             break;
         case 0x01:
         case 0x02:
         case 0x03:
-            _ctrl = std::make_unique<MBC1>(std::move(data));
-            _has_battery = mbc == 0x3;
+            _ctrl = std::make_unique<MBC1>(
+                std::move(rom), ram_size, mbc == 0x3 ? save : "");
             break;
         case 0x0F:
         case 0x10:
         case 0x11:
         case 0x12:
-        case 0x13:
-            _ctrl = std::make_unique<MBC3>(std::move(data));
-            _has_battery = ((mbc & 1) ^ ((mbc >> 1) & 1)) == 0;
+        case 0x13: {
+            bool battery = ((mbc & 1) ^ ((mbc >> 1) & 1)) == 0;
+            _ctrl = std::make_unique<MBC3>(
+                std::move(rom), ram_size, battery ? save : "", sched);
             break;
+        }
         case 0x19:
         case 0x1A:
         case 0x1B:
         case 0x1C:
         case 0x1D:
-        case 0x1E:
-            _ctrl = std::make_unique<MBC5>(std::move(data));
-            _has_battery = mbc == 0x1B || mbc == 0x1E;
+        case 0x1E: {
+            bool battery = mbc == 0x1B || mbc == 0x1E;
+            _ctrl = std::make_unique<MBC5>(
+                std::move(rom), ram_size, battery ? save : "");
             break;
-    }
-
-    if (_has_battery) {
-        _ctrl->LoadRam(_game_name + ".save");
+        }
     }
 }
 
-const Cartridge::Addr& Cartridge::Controller::FindAddr(uint16_t addr) const {
-    int b = 0;
-    int e = _mem_map.size();
-
-    while (true) {
-        if (b == e) {
-            Error(addr);
-        }
-
-        int m = (b + e) / 2;
-
-        if (_mem_map[m]._begin <= addr && addr <= _mem_map[m]._end) {
-            return _mem_map[m];
-        }
+void Cartridge::SaveState(StateWriter& w) const {
+    w.Write(uint32_t(_game_name.size()));
+    w.WriteBytes(_game_name.data(), _game_name.size());
+    _ctrl->SaveState(w);
+}
 
-        if (addr < _mem_map[m]._begin) {
-            e = m;
-        } else {
-            b = m + 1;
-        }
+void Cartridge::LoadState(StateReader& r) {
+    uint32_t size;
+    r.Read(size);
+    std::string name(size, '\0');
+    r.ReadBytes(&name[0], size);
+    if (name != _game_name) {
+        throw std::runtime_error("Save state is for another game: " + name);
     }
+    _ctrl->LoadState(r);
 }
 
-void Cartridge::Controller::LoadRam(const std::string& filename) {
-    std::ifstream file(filename, std::ios::in | std::ios::binary);
-    if (!file) {
+Cartridge::Controller::Controller(std::shared_ptr<const RomFile> rom,
+                                  int ram_size,
+                                  const std::string& save)
+    : _rom(std::move(rom)),
+      _ram(nullptr),
+      _ram_size(ram_size),
+      _rom_bank0(nullptr),
+      _rom_bankn(nullptr),
+      _ram_bank(nullptr) {
+    if (ram_size == 0) {
         return;
     }
+    if (!save.empty()) {
+        try {
+            _ram_file = std::make_unique<RamFile>(save, ram_size);
+        } catch (const std::exception& e) {
+            cerror << e.what() << ", the game won't be saved\n";
+        }
+    }
+    if (!_ram_file) {
+        _ram_file = std::make_unique<RamFile>(ram_size);
+        // Starts from the save anyway
+        if (!save.empty()) {
+            std::ifstream file(save, std::ios::in | std::ios::binary);
+            file.read(reinterpret_cast<char*>(_ram_file->data()), ram_size);
+        }
+    }
+    _ram = _ram_file->data();
+}
 
-    file.read(reinterpret_cast<char*>(&_ram[0]), _ram.size());
+void Cartridge::Controller::SaveState(StateWriter& w) const {
+    w.Write(uint32_t(_ram_size));
+    w.WriteBytes(_ram, _ram_size);
 }
 
-void Cartridge::Controller::SaveRam(const std::string& filename) {
-    std::ofstream file(filename, std::ios::out | std::ios::binary);
-    if (!file) {
-        return;
+void Cartridge::Controller::LoadState(StateReader& r) {
+    uint32_t size;
+    r.Read(size);
+    if (size != _ram_size) {
+        throw std::runtime_error("Save state doesn't match the machine");
     }
+    r.ReadBytes(_ram, _ram_size);
+}
 
-    file.write(reinterpret_cast<char*>(&_ram[0]), _ram.size());
+void Cartridge::Controller::SelectBanks(int bank0, int bankn, int ram) {
+    _rom_bank0 = RomBank(bank0);
+    _rom_bankn = RomBank(bankn);
+    const int ram_banks = _ram_size / 0x2000;
+    if (ram < 0 || ram_banks == 0) {
+        _ram_bank = nullptr;
+    } else {
+        _ram_bank = &_ram[(ram % ram_banks) * 0x2000];
+    }
 }
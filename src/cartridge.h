@@ -4,64 +4,120 @@
 #include <iostream>
 #include <memory>
 #include <vector>
+#include "ramfile.h"
+#include "romfile.h"
+#include "scheduler.h"
+#include "state.h"
 #include "utils.h"
 
 class Cartridge {
    public:
-    Cartridge(std::string filename);
-    ~Cartridge() {
-        if (_has_battery) {
-            _ctrl->SaveRam(_game_name + ".save");
-        }
-    }
-
-    struct Addr {
-        std::string _name;
-        int _begin;
-        int _end;
-        std::function<byte(uint16_t)> _get;
-        std::function<void(uint16_t, byte)> _set;
-    };
+    // The machine clock drives the MBC3 real time clock
+    Cartridge(std::string filename, const Scheduler& sched);
 
     class Controller {
        public:
-        Controller(std::vector<byte>&& data, int ram_size)
-            : _data(std::move(data)), _ram(ram_size) {}
+        // ram_size comes from the header. A battery backed RAM is mapped from
+        // the save file, if any.
+        Controller(std::shared_ptr<const RomFile> rom,
+                   int ram_size,
+                   const std::string& save = "");
 
         virtual ~Controller() = default;
 
-        const Addr& Find(uint16_t idx) const { return FindAddr(idx); }
-        byte Read(uint16_t idx) const { return FindAddr(idx)._get(idx); }
-
-        void Write(uint16_t idx, byte v) { FindAddr(idx)._set(idx, v); }
-        void LoadRam(const std::string& filename);
-        void SaveRam(const std::string& filename);
-        int rom_size() const { return _data.size(); }
+        // ROM and the mapped RAM bank are plain memory. Only the registers,
+        // at 0x0000-0x7FFF, and the RAM area while unmapped need the mapper.
+        byte Read(uint16_t idx) const {
+            if (idx < 0x4000) {
+                return _rom_bank0[idx];
+            } else if (idx < 0x8000) {
+                return _rom_bankn[idx - 0x4000];
+            } else if (_ram_bank) {
+                return _ram_bank[idx - 0xA000];
+            }
+            return ReadRam(idx);
+        }
+        void Write(uint16_t idx, byte v) {
+            if (idx >= 0xA000 && _ram_bank) {
+                _ram_bank[idx - 0xA000] = v;
+            } else {
+                WriteRegister(idx, v);
+            }
+        }
+        const byte* rom() const { return _rom->data(); }
+        int rom_size() const { return _rom->size(); }
         int rom_banks() const { return rom_size() / 0x4000; }
+        int ram_size() const { return _ram_size; }
+
+        // ROM banks currently mapped at 0x0000 and 0x4000
+        const byte* rom_bank0() const { return _rom_bank0; }
+        const byte* rom_bankn() const { return _rom_bankn; }
+        // RAM bank mapped at 0xA000, nullptr when accesses need the handlers
+        byte* ram_bank() const { return _ram_bank; }
+
+        // Mappers with a real time clock advance it by the time elapsed
+        // since it was saved, instead of only counting the machine cycles.
+        virtual void UseWallClock() {}
+
+        // Mappers override these to add their registers to the RAM
+        virtual void SaveState(StateWriter& w) const;
+        virtual void LoadState(StateReader& r);
 
        protected:
-        byte& Rom(uint32_t idx) { return _data[idx]; }
-        byte Rom(uint32_t idx) const { return _data[idx]; }
+        // Reads from 0xA000-0xBFFF while no RAM bank is mapped
+        virtual byte ReadRam(uint16_t) const { return 0xFF; }
+        // Writes to 0x0000-0x7FFF, and to 0xA000-0xBFFF while no RAM bank is
+        // mapped
+        virtual void WriteRegister(uint16_t idx, byte v) = 0;
+
+        // Mappers call it when the game disables the RAM, which it does once
+        // done saving.
+        void FlushRam() {
+            if (_ram_file) {
+                _ram_file->Flush();
+            }
+        }
+
+        byte Rom(uint32_t idx) const { return _rom->data()[idx]; }
+        const byte* RomBank(int bank) const {
+            return _rom->data() + (bank % rom_banks()) * 0x4000;
+        }
 
         byte& Ram(uint32_t idx) { return _ram[idx]; }
         byte Ram(uint32_t idx) const { return _ram[idx]; }
 
-        std::vector<Addr> _mem_map;
+        // Mappers call it whenever a bank register changes, so that reads are
+        // a pointer plus an offset. A negative RAM bank leaves it unmapped.
+        void SelectBanks(int bank0, int bankn, int ram);
 
        private:
-        const Addr& FindAddr(uint16_t) const;
-
-        std::vector<byte> _data;
-        std::vector<byte> _ram;
+        std::shared_ptr<const RomFile> _rom;
+        std::unique_ptr<RamFile> _ram_file;
+        // nullptr without RAM
+        byte* _ram;
+        size_t _ram_size;
+        const byte* _rom_bank0;
+        const byte* _rom_bankn;
+        byte* _ram_bank;
     };
 
-    const Addr& Find(uint16_t index) const { return _ctrl->Find(index); }
     byte Read(uint16_t index) const { return _ctrl->Read(index); }
     void Write(uint16_t index, byte val) { _ctrl->Write(index, val); }
+    const byte* rom_bank0() const { return _ctrl->rom_bank0(); }
+    const byte* rom_bankn() const { return _ctrl->rom_bankn(); }
+    byte* ram_bank() const { return _ctrl->ram_bank(); }
+    // The whole ROM file
+    const byte* rom() const { return _ctrl->rom(); }
+    int rom_size() const { return _ctrl->rom_size(); }
+    int ram_size() const { return _ctrl->ram_size(); }
+
+    // Runs are reproducible unless called
+    void UseWallClock() { _ctrl->UseWallClock(); }
+
+    void SaveState(StateWriter& w) const;
+    void LoadState(StateReader& r);
 
    private:
-    std::vector<byte> LoadGame(const std::string& filename);
     std::unique_ptr<Controller> _ctrl;
     std::string _game_name;
-    bool _has_battery;
 };
@@ -0,0 +1,68 @@
+#include "cli.h"
+
+#include <signal.h>
+#include <cstdlib>
+#include <iostream>
+
+#include "gameboy.h"
+
+static Gameboy* gb_ptr;
+
+static void segv_handler(int) {
+    gb_ptr->cpu().Dump();
+    exit(1);
+}
+
+static void sigint_handler(int) {
+    std::cout << "END\n";
+    gb_ptr->poweroff();
+}
+
+bool ParseCommonOption(int argc, char** argv, int& i, CommonOptions& opts) {
+    const std::string arg = argv[i];
+    if (arg[0] != '-') {
+        opts.gamefile = arg;
+    } else if (arg == "--show-instr") {
+        cinstr.enabled = true;
+    } else if (arg == "--show-debug") {
+        cdebug.enabled = true;
+    } else if (arg == "--show-event") {
+        cevent.enabled = true;
+    } else if (arg == "--serial") {
+        serial.enabled = true;
+    } else if (arg == "--errors") {
+        cerror.enabled = true;
+    } else if (arg == "--jit") {
+        opts.jit = true;
+    } else if (arg == "--wall-clock") {
+        opts.wall_clock = true;
+    } else if (arg == "--aot" && i + 1 < argc) {
+        opts.aot = argv[++i];
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void ApplyCommonOptions(Gameboy& gb, const CommonOptions& opts) {
+    gb.cpu().set_jit(opts.jit);
+    if (opts.wall_clock) {
+        gb.cartridge().UseWallClock();
+    }
+    if (!opts.aot.empty()) {
+        gb.cpu().LoadAot(opts.aot);
+    }
+}
+
+void InstallSignalHandlers(Gameboy& gb) {
+    gb_ptr = &gb;
+
+    struct sigaction action = {};
+    action.sa_handler = segv_handler;
+    sigaction(SIGSEGV, &action, nullptr);
+
+    struct sigaction int_action = {};
+    int_action.sa_handler = sigint_handler;
+    sigaction(SIGINT, &int_action, nullptr);
+    sigaction(SIGTERM, &int_action, nullptr);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+class Gameboy;
+
+// Command line shared by emu and emu-headless.
+struct CommonOptions {
+    CommonOptions() : jit(false), wall_clock(false) {}
+
+    std::string gamefile;
+    bool jit;
+    bool wall_clock;
+    std::string aot;
+};
+
+// Parses argv[i] if it is a common option, moving i past its argument.
+// Returns false for the options left to the caller.
+bool ParseCommonOption(int argc, char** argv, int& i, CommonOptions& opts);
+
+// Applies the options to a powered on machine.
+void ApplyCommonOptions(Gameboy& gb, const CommonOptions& opts);
+
+// SIGSEGV dumps the CPU and exits, SIGINT and SIGTERM power the machine off.
+void InstallSignalHandlers(Gameboy& gb);
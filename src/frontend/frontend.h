@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "gpu/color.h"
+
+// The emulator core only talks to its host through these interfaces, so
+// that it can run with or without SDL.
+
+// Receives each complete 160x144 frame.
+class Display {
+   public:
+    virtual ~Display() = default;
+    virtual void Present(const Color* pixels) = 0;
+};
+
+// Plays the APU output. The output pulls samples from the source whenever
+// it needs more, possibly from another thread.
+class AudioOutput {
+   public:
+    using Source = std::function<void(int16_t* samples, int nb_samples)>;
+
+    virtual ~AudioOutput() = default;
+    virtual void Start(Source source) = 0;
+    // The source must not be called anymore once Stop() returns.
+    virtual void Stop() = 0;
+};
+
+// State of the joypad.
+class Input {
+   public:
+    enum Key {
+        A = 1 << 0,
+        B = 1 << 1,
+        SELECT = 1 << 2,
+        START = 1 << 3,
+        RIGHT = 1 << 4,
+        LEFT = 1 << 5,
+        UP = 1 << 6,
+        DOWN = 1 << 7
+    };
+
+    virtual ~Input() = default;
+    // Processes pending events and returns the mask of the keys held.
+    virtual int Poll() = 0;
+    virtual bool quit() const = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "frontend.h"
+
+// Backends for running without any host device.
+
+// Keeps the last frame in memory.
+class MemoryDisplay : public Display {
+   public:
+    MemoryDisplay() : _frame(160 * 144), _frames(0) {}
+
+    void Present(const Color* pixels) override {
+        std::copy(pixels, pixels + _frame.size(), _frame.begin());
+        ++_frames;
+    }
+
+    const std::vector<Color>& frame() const { return _frame; }
+    int frames() const { return _frames; }
+
+    // FNV-1a of the last frame, to compare runs
+    uint64_t checksum() const {
+        uint64_t h = 14695981039346656037ull;
+        for (const Color& c : _frame) {
+            for (uint8_t x : {c.a, c.r, c.g, c.b}) {
+                h = (h ^ x) * 1099511628211ull;
+            }
+        }
+        return h;
+    }
+
+   private:
+    std::vector<Color> _frame;
+    int _frames;
+};
+
+// Never pulls any sample.
+class NullAudio : public AudioOutput {
+   public:
+    void Start(Source) override {}
+    void Stop() override {}
+};
+
+// No key is ever pressed.
+class NullInput : public Input {
+   public:
+    int Poll() override { return 0; }
+    bool quit() const override { return false; }
+};
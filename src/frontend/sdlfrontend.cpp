@@ -0,0 +1,97 @@
+#include "sdlfrontend.h"
+
+#include <iostream>
+#include <thread>
+
+SdlFrontend::SdlFrontend()
+    : _tx(_win),
+      _keys(0),
+      _max_speed(false),
+      _quit(false),
+      _frame_start(std::chrono::high_resolution_clock::now()) {}
+
+void SdlFrontend::Present(const Color* pixels) {
+    if (!_max_speed) {
+        std::this_thread::sleep_until(
+            _frame_start + std::chrono::nanoseconds(1000000000 / 60));
+        _frame_start = std::chrono::high_resolution_clock::now();
+    }
+    _tx.Update(pixels);
+    _win.Clear();
+    _tx.Draw(_win);
+    _win.Display();
+}
+
+static int KeyMask(SDL_Keycode key) {
+    switch (key) {
+        case SDLK_DOWN:
+            return Input::DOWN;
+        case SDLK_UP:
+            return Input::UP;
+        case SDLK_LEFT:
+            return Input::LEFT;
+        case SDLK_RIGHT:
+            return Input::RIGHT;
+        case SDLK_RETURN:
+            return Input::START;
+        case SDLK_BACKSPACE:
+            return Input::SELECT;
+        case SDLK_d:
+            return Input::B;
+        case SDLK_s:
+            return Input::A;
+        default:
+            return 0;
+    }
+}
+
+int SdlFrontend::Poll() {
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            _quit = true;
+        }
+        if (event.type == SDL_KEYDOWN) {
+            _keys |= KeyMask(event.key.keysym.sym);
+            _max_speed |= event.key.keysym.sym == SDLK_LCTRL;
+        } else if (event.type == SDL_KEYUP) {
+            _keys &= ~KeyMask(event.key.keysym.sym);
+            _max_speed &= event.key.keysym.sym != SDLK_LCTRL;
+        }
+    }
+    return _keys;
+}
+
+SdlAudio::SdlAudio() : _dev(0) { SDL_InitSubSystem(SDL_INIT_AUDIO); }
+
+SdlAudio::~SdlAudio() { Stop(); }
+
+void SdlAudio::Start(Source source) {
+    _source = source;
+
+    SDL_AudioSpec spec;
+
+    SDL_memset(&spec, 0, sizeof(spec));
+    spec.freq = 44100;
+    spec.format = AUDIO_S16;
+    spec.channels = 1;
+    spec.samples = 4096;
+    spec.callback = SdlAudio::_Run;
+    spec.userdata = this;
+    _dev = SDL_OpenAudioDevice(nullptr, 0, &spec, nullptr, 0);
+    std::cout << "DEV: " << _dev << " SAMPLES: " << spec.samples << "\n";
+    std::cout << SDL_GetError() << "\n";
+    SDL_PauseAudioDevice(_dev, 0);
+}
+
+void SdlAudio::Stop() {
+    if (_dev) {
+        SDL_CloseAudioDevice(_dev);
+        _dev = 0;
+    }
+}
+
+void SdlAudio::_Run(void* thisptr, uint8_t* stream, int len) {
+    static_cast<SdlAudio*>(thisptr)->_source(
+        reinterpret_cast<int16_t*>(stream), len / 2);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+
+#include "frontend.h"
+#include "sdl.h"
+
+// Window and keyboard. Frames are paced to 60 per second unless left ctrl
+// is held.
+class SdlFrontend : public Display, public Input {
+   public:
+    SdlFrontend();
+
+    void Present(const Color* pixels) override;
+
+    int Poll() override;
+    bool quit() const override { return _quit; }
+
+   private:
+    struct Window {
+        Window()
+            : _win(SDL_CreateWindow("Gameboy",
+                                    SDL_WINDOWPOS_UNDEFINED,
+                                    SDL_WINDOWPOS_UNDEFINED,
+                                    160 * 4,
+                                    144 * 4,
+                                    0)),
+              _renderer(SDL_CreateRenderer(_win, -1, 0)) {}
+
+        ~Window() {
+            SDL_DestroyRenderer(_renderer);
+            SDL_DestroyWindow(_win);
+        }
+
+        operator SDL_Window*() const { return _win; }
+        operator SDL_Renderer*() const { return _renderer; }
+
+        void Clear() { SDL_RenderClear(_renderer); }
+        void Display() { SDL_RenderPresent(_renderer); }
+
+       private:
+        SDL_Window* _win;
+        SDL_Renderer* _renderer;
+    };
+
+    struct Texture {
+        Texture(Window& w)
+            : _texture(SDL_CreateTexture(w,
+                                         SDL_PIXELFORMAT_RGBA8888,
+                                         SDL_TEXTUREACCESS_STREAMING,
+                                         160,
+                                         144)) {}
+        ~Texture() { SDL_DestroyTexture(_texture); }
+
+        operator SDL_Texture*() const { return _texture; }
+
+        void Update(const Color* c) {
+            SDL_UpdateTexture(_texture, nullptr, c, 160 * sizeof(Color));
+        }
+
+        void Draw(Window& w) { SDL_RenderCopy(w, _texture, nullptr, nullptr); }
+
+       private:
+        SDL_Texture* _texture;
+    };
+
+    // SDL_Init() must run before the window is created
+    struct Init {
+        Init() {
+            SDL_Init(SDL_INIT_VIDEO);
+            atexit(SDL_Quit);
+        }
+    };
+
+    Init _init;
+    Window _win;
+    Texture _tx;
+    int _keys;
+    bool _max_speed;
+    bool _quit;
+    std::chrono::high_resolution_clock::time_point _frame_start;
+};
+
+// Audio device, 44100Hz mono.
+class SdlAudio : public AudioOutput {
+   public:
+    SdlAudio();
+    ~SdlAudio();
+
+    void Start(Source source) override;
+    void Stop() override;
+
+   private:
+    static void _Run(void* thisptr, uint8_t* stream, int len);
+
+    Source _source;
+    SDL_AudioDeviceID _dev;
+};
@@ -0,0 +1,58 @@
+#include "gameboy.h"
+
+#include <stdexcept>
+
+Gameboy::Gameboy(const std::string& gamefile,
+                 Display& display,
+                 AudioOutput& audio,
+                 Input& input)
+    : _video(_sched, display),
+      _sound(_sched, audio),
+      _card(gamefile, _sched),
+      _lk(_sched),
+      _keypad(input),
+      _timer(_sched),
+      _addr(_card, _video, _lk, _keypad, _timer, _sound, _ints, _sched),
+      _cpu(_addr, _video, _lk, _timer, _sound, _keypad, _ints, _sched) {}
+
+void Gameboy::SaveState(std::vector<byte>& out) const {
+    out.clear();
+    StateWriter w(out);
+    w.Write(kStateMagic);
+    w.Write(kStateVersion);
+    _card.SaveState(w);
+    _sched.SaveState(w);
+    _cpu.SaveState(w);
+    _addr.SaveState(w);
+    _video.SaveState(w);
+    _sound.SaveState(w);
+    _lk.SaveState(w);
+    _keypad.SaveState(w);
+    _timer.SaveState(w);
+    _ints.SaveState(w);
+}
+
+void Gameboy::LoadState(const std::vector<byte>& in) {
+    StateReader r(in);
+    uint32_t magic;
+    uint32_t version;
+    r.Read(magic);
+    r.Read(version);
+    if (magic != kStateMagic) {
+        throw std::runtime_error("Not a save state");
+    }
+    if (version != kStateVersion) {
+        throw std::runtime_error("Unsupported save state version " +
+                                 std::to_string(version));
+    }
+    _card.LoadState(r);
+    _sched.LoadState(r);
+    _cpu.LoadState(r);
+    _addr.LoadState(r);
+    _video.LoadState(r);
+    _sound.LoadState(r);
+    _lk.LoadState(r);
+    _keypad.LoadState(r);
+    _timer.LoadState(r);
+    _ints.LoadState(r);
+}
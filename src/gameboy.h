@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "addressbus.h"
+#include "apu/sound.h"
+#include "cartridge.h"
+#include "frontend/frontend.h"
+#include "gpu/video.h"
+#include "interrupts.h"
+#include "keypad.h"
+#include "link.h"
+#include "scheduler.h"
+#include "timer.h"
+#include "z80.h"
+
+// The whole machine, wired to the host through the frontend interfaces.
+class Gameboy {
+   public:
+    Gameboy(const std::string& gamefile,
+            Display& display,
+            AudioOutput& audio,
+            Input& input);
+
+    // Runs until poweroff() or until the input asks to quit
+    void Run() { _cpu.Process(); }
+    // Runs at least n more cycles and stops on an instruction boundary,
+    // where the machine can be saved.
+    void RunCycles(uint64_t n) { _cpu.Process(_sched.now() + n); }
+    void RunFrames(int n) { RunCycles(uint64_t(n) * kCyclesPerFrame); }
+    void poweroff() { _cpu.poweroff(); }
+
+    static const int kCyclesPerFrame = 70224;
+
+    // Snapshots the whole machine into out, replacing its content. Reusing
+    // the same buffer avoids any allocation after the first snapshot.
+    void SaveState(std::vector<byte>& out) const;
+    // Throws if the state is not a valid snapshot of this game
+    void LoadState(const std::vector<byte>& in);
+
+    Z80& cpu() { return _cpu; }
+    Cartridge& cartridge() { return _card; }
+    Scheduler& scheduler() { return _sched; }
+
+   private:
+    Scheduler _sched;
+    Video _video;
+    Sound _sound;
+    Cartridge _card;
+    LinkCable _lk;
+    Keypad _keypad;
+    Timer _timer;
+    Interrupts _ints;
+    AddressBus _addr;
+    Z80 _cpu;
+};
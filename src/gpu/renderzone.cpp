@@ -1,17 +1,105 @@
 #include "renderzone.h"
 
-#include <thread>
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 
 void RenderZone::Render() {
-    if (!_max_speed) {
-        std::this_thread::sleep_until(
-            _frame_start + std::chrono::nanoseconds(1000000000 / 60));
-        _frame_start = std::chrono::high_resolution_clock::now();
+    _display.Present(&_pixels[0]);
+    std::fill(_z.begin(), _z.end(), 0);
+}
+
+void RenderZone::RenderSpan(int line,
+                            int x,
+                            const byte* colors,
+                            int n,
+                            const Palette& palette,
+                            byte z0,
+                            byte z) {
+    Color* pixels = &_pixels[160 * line + x];
+    byte* prios = &_z[160 * line + x];
+    const Color table[4] = {palette.GetColor(0),
+                            palette.GetColor(1),
+                            palette.GetColor(2),
+                            palette.GetColor(3)};
+    const int i = RenderBlocks(pixels, prios, colors, n, table, z0, z);
+    RenderPixels(pixels + i, prios + i, colors + i, n - i, table, z0, z);
+}
+
+#ifdef __SSSE3__
+int RenderZone::RenderBlocks(Color* pixels,
+                             byte* prios,
+                             const byte* colors,
+                             int n,
+                             const Color* table,
+                             byte z0,
+                             byte z) {
+    static_assert(sizeof(Color) == 4, "a palette must fit in a register");
+    __m128i lut;
+    memcpy(&lut, table, sizeof(lut));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i z0s = _mm_set1_epi8(z0);
+    const __m128i zs = _mm_set1_epi8(z);
+    // Repeats the bytes of pixels 4k to 4k + 3 four times each
+    alignas(16) static const byte kSpread[4][16] = {
+        {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3},
+        {4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7},
+        {8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 11, 11},
+        {12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15}};
+    // Offset of each byte in its color
+    const __m128i byte_nbr = _mm_set1_epi32(0x03020100);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m128i idx = _mm_loadu_si128((const __m128i*)(colors + i));
+        const __m128i is0 = _mm_cmpeq_epi8(idx, zero);
+        const __m128i new_z =
+            _mm_or_si128(_mm_and_si128(is0, z0s), _mm_andnot_si128(is0, zs));
+        const __m128i old_z = _mm_loadu_si128((const __m128i*)(prios + i));
+        // new_z >= old_z
+        const __m128i draw =
+            _mm_cmpeq_epi8(_mm_max_epu8(new_z, old_z), new_z);
+        _mm_storeu_si128((__m128i*)(prios + i),
+                         _mm_or_si128(_mm_and_si128(draw, new_z),
+                                      _mm_andnot_si128(draw, old_z)));
+
+        for (int k = 0; k < 4; ++k) {
+            const __m128i spread = _mm_load_si128((const __m128i*)kSpread[k]);
+            // Indexes are below 4, shifting 16 bits lanes doesn't carry
+            const __m128i offsets = _mm_add_epi8(
+                _mm_slli_epi16(_mm_shuffle_epi8(idx, spread), 2), byte_nbr);
+            const __m128i rgb = _mm_shuffle_epi8(lut, offsets);
+            const __m128i mask = _mm_shuffle_epi8(draw, spread);
+            __m128i* out = (__m128i*)(pixels + i + 4 * k);
+            const __m128i old = _mm_loadu_si128(out);
+            _mm_storeu_si128(out,
+                             _mm_or_si128(_mm_and_si128(mask, rgb),
+                                          _mm_andnot_si128(mask, old)));
+        }
     }
-    _tx.Update(&_pixels[0]);
-    _win.Clear();
-    _tx.Draw(_win);
-    _win.Display();
+    return i;
+}
+#else
+int RenderZone::RenderBlocks(
+    Color*, byte*, const byte*, int, const Color*, byte, byte) {
+    return 0;
+}
+#endif
 
-    std::fill(_z.begin(), _z.end(), 0);
+void RenderZone::RenderPixels(Color* pixels,
+                              byte* prios,
+                              const byte* colors,
+                              int n,
+                              const Color* table,
+                              byte z0,
+                              byte z) {
+    for (int i = 0; i < n; ++i) {
+        const byte new_z = colors[i] ? z : z0;
+        if (new_z >= prios[i]) {
+            prios[i] = new_z;
+            pixels[i] = table[colors[i]];
+        }
+    }
 }
@@ -1,13 +1,12 @@
 #include "spritestable.h"
+
+#include <algorithm>
+
 #include "video.h"
 
-int8_t SpritesTable::GetSpritePix(const SpriteAttributes& sprite,
-                                  int32_t y,
-                                  int32_t x) const {
+const byte* SpritesTable::GetSpriteRow(const SpriteAttributes& sprite,
+                                       int32_t y) const {
     int tile = sprite.tileno();
-    if (sprite.x_flip()) {
-        x = 7 - x;
-    }
 
     if (sprite.y_flip()) {
         y = (_video.lcdc().sprite_size() ? 15 : 7) - y;
@@ -16,11 +15,11 @@ int8_t SpritesTable::GetSpritePix(const SpriteAttributes& sprite,
     if (_video.lcdc().sprite_size()) {
         tile = tile & ~1;
     }
-    uint32_t addr = 0x8000 + tile * 16 + y * 2;
 
-    int8_t l = (_video.vram(addr) >> (7 - x)) & 1;
-    int8_t h = (_video.vram(addr + 1) >> (7 - x)) & 1;
-    return (h << 1) | l;
+    if (sprite.x_flip()) {
+        return _video.tiles().flipped_row(tile, y);
+    }
+    return _video.tiles().row(tile, y);
 }
 
 const SpriteAttributes& SpritesTable::GetSpriteAttr(int sprite_id) const {
@@ -28,19 +27,80 @@ const SpriteAttributes& SpritesTable::GetSpriteAttr(int sprite_id) const {
         _video.oam_ptr())[sprite_id];
 }
 
-void SpritesTable::Render(int line) {
-    auto pixs = _video.render_zone().pixs(line);
-    const int height = _video.lcdc().sprite_size() ? 16 : 8;
-    for (uint32_t i = 0; i < 40; ++i) {
-        auto& sprite = GetSpriteAttr(i);
-        if (sprite.y_pos() > line || sprite.y_pos() + height < line) {
-            continue;
+void SpritesTable::Register(int sprite_id, bool add) {
+    const uint64_t bit = uint64_t(1) << sprite_id;
+    const int top = std::max(0, _tops[sprite_id]);
+    const int bottom = std::min(kLines, _tops[sprite_id] + _height);
+    for (int y = top; y < bottom; ++y) {
+        if (add) {
+            _lines[y].overlapping |= bit;
+        } else {
+            _lines[y].overlapping &= ~bit;
+        }
+        _lines[y].dirty = true;
+    }
+}
+
+void SpritesTable::UpdateSprite(int sprite_id) {
+    Register(sprite_id, false);
+    _tops[sprite_id] = GetSpriteAttr(sprite_id).y_pos();
+    Register(sprite_id, true);
+}
+
+void SpritesTable::UpdateAll() {
+    for (Line& line : _lines) {
+        line.overlapping = 0;
+        line.dirty = true;
+    }
+    _height = _video.lcdc().sprite_size() ? 16 : 8;
+    for (int i = 0; i < 40; ++i) {
+        _tops[i] = GetSpriteAttr(i).y_pos();
+        Register(i, true);
+    }
+}
+
+void SpritesTable::UpdateHeight() {
+    if ((_video.lcdc().sprite_size() ? 16 : 8) != _height) {
+        UpdateAll();
+    }
+}
+
+// The first 10 sprites in OAM order are displayed, even those off screen
+// horizontally.
+void SpritesTable::SortLine(Line& line) const {
+    line.count = 0;
+    for (uint64_t left = line.overlapping; left && line.count < kMaxPerLine;
+         left &= left - 1) {
+        const int id = __builtin_ctzll(left);
+        const int prio = GetSpriteAttr(id).priority();
+        // Sprites drawn later cover the ones before, so the ones on top go
+        // last: after those further right, and those later in OAM.
+        int k = line.count++;
+        for (; k > 0; --k) {
+            const int before = line.drawn[k - 1];
+            if (GetSpriteAttr(before).priority() > prio) {
+                break;
+            }
+            line.drawn[k] = before;
         }
+        line.drawn[k] = id;
+    }
+    line.dirty = false;
+}
 
-        int y = line - sprite.y_pos();
+void SpritesTable::Render(int line) {
+    Line& sprites = _lines[line];
+    if (sprites.dirty) {
+        SortLine(sprites);
+    }
+
+    auto pixs = _video.render_zone().pixs(line);
+    for (int i = 0; i < sprites.count; ++i) {
+        auto& sprite = GetSpriteAttr(sprites.drawn[i]);
+        const byte* row = GetSpriteRow(sprite, line - sprite.y_pos());
 
         for (int x = 0; x < 8; ++x) {
-            int color = GetSpritePix(sprite, y, x);
+            int color = row[x];
 
             if (color == 0) {
                 continue;
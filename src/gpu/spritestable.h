@@ -1,6 +1,10 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+
 #include "palette.h"
+#include "state.h"
 
 class Video;
 
@@ -12,6 +16,9 @@ class SpriteAttributes {
 
     int y_pos() const { return _y_pos - 16; }
     int x_pos() const { return _x_pos - 8; }
+    // Overlapping sprites are drawn with the lowest one on top, ties going to
+    // the first in OAM
+    int priority() const { return _x_pos; }
     byte tileno() const { return _tileno; }
 
     bool y_flip() const { return _flags & (1 << 6); }
@@ -26,25 +33,67 @@ class SpriteAttributes {
     byte _flags;
 };
 
+// Each line keeps the set of sprites overlapping it, updated when OAM or the
+// sprite size change. The 10 sprites the hardware displays are picked from it
+// and ordered when the line is first drawn after a change.
 class SpritesTable {
    public:
-    SpritesTable(Video& video) : _video(video) {}
+    // OAM is cleared at power on: no sprite is on screen
+    SpritesTable(Video& video) : _video(video), _height(8) {
+        _lines.fill(Line{0, true, 0, {}});
+        _tops.fill(-16);
+    }
 
     void Render(int line);
 
+    // Called after the position of a sprite changed
+    void UpdateSprite(int sprite_id);
+    // Called after the whole OAM changed
+    void UpdateAll();
+    // Called after LCDC changed, in case the sprite size did
+    void UpdateHeight();
+
     byte obj0_palette() const { return _obj0_palette.Get(); }
     void set_obj0_palette(byte x) { _obj0_palette.Set(x); }
 
     byte obj1_palette() const { return _obj1_palette.Get(); }
     void set_obj1_palette(byte x) { _obj1_palette.Set(x); }
 
+    void SaveState(StateWriter& w) const {
+        w.Write(_obj0_palette);
+        w.Write(_obj1_palette);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_obj0_palette);
+        r.Read(_obj1_palette);
+    }
+
    private:
-    int8_t GetSpritePix(const SpriteAttributes& sprite,
-                        int32_t y,
-                        int32_t x) const;
+    static const int kLines = 144;
+    static const int kMaxPerLine = 10;
+
+    struct Line {
+        // Bit i is set if sprite i overlaps the line
+        uint64_t overlapping;
+        bool dirty;
+        int count;
+        // The sprites displayed, in drawing order: the one on top last
+        byte drawn[kMaxPerLine];
+    };
+
+    // Adds or removes the sprite from the lines it overlaps
+    void Register(int sprite_id, bool add);
+    void SortLine(Line& line) const;
+
+    // Row y of the sprite, with its flips applied
+    const byte* GetSpriteRow(const SpriteAttributes& sprite, int32_t y) const;
     const SpriteAttributes& GetSpriteAttr(int sprite_id) const;
 
     Palette _obj0_palette;
     Palette _obj1_palette;
     Video& _video;
+    std::array<Line, kLines> _lines;
+    // First line of each sprite when registered, and their height then
+    std::array<int, 40> _tops;
+    int _height;
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+
+#include "utils.h"
+
+// The 384 tiles of VRAM decoded to one color index per pixel, along with
+// horizontally flipped copies for sprites. Rows of consecutive tiles are
+// contiguous so that a 8x16 sprite reads its two tiles as one.
+class TileCache {
+   public:
+    TileCache() {
+        for (auto& row : _rows) {
+            row.fill(0);
+        }
+        for (auto& row : _flipped_rows) {
+            row.fill(0);
+        }
+    }
+
+    // Decodes again the row holding the tile data byte at vram[offset].
+    void Update(const Data8* vram, int offset) {
+        const int row = offset / 2;
+        const byte l = vram[row * 2].u;
+        const byte h = vram[row * 2 + 1].u;
+        for (int x = 0; x < 8; ++x) {
+            byte color = (((h >> (7 - x)) & 1) << 1) | ((l >> (7 - x)) & 1);
+            _rows[row][x] = color;
+            _flipped_rows[row][7 - x] = color;
+        }
+    }
+
+    const byte* row(int tile, int y) const { return &_rows[tile * 8 + y][0]; }
+    const byte* flipped_row(int tile, int y) const {
+        return &_flipped_rows[tile * 8 + y][0];
+    }
+
+    static const int kTileDataSize = 0x9800 - 0x8000;
+
+   private:
+    std::array<std::array<byte, 8>, kTileDataSize / 2> _rows;
+    std::array<std::array<byte, 8>, kTileDataSize / 2> _flipped_rows;
+};
@@ -10,99 +10,143 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
+#include "profiler.h"
 #include "video.h"
 
-void Video::Clock() {
-    ++_clock;
-    char mode = _state.mode();
+void Video::Step() {
     _vblank_int = 0;
     _phase_changed = false;
     _state.set_coincidence(false);
 
-    if (mode == LCDStatus::SEARCH_OAM && _clock == 80) {
-        _clock = 0;
-        _state.set_mode(LCDStatus::TRANSFER);
-        _phase_changed = true;
-    } else if (mode == LCDStatus::TRANSFER && _clock == 172) {
-        _clock = 0;
-        _state.set_mode(LCDStatus::HBLANK);
-        _phase_changed = true;
-    } else if (mode == LCDStatus::HBLANK && _clock == 204) {
-        _clock = 0;
-        Render(_line);
-        ++_line;
-        _state.set_coincidence(_line == _ly_comp);
-        if (_line == 144) {
-            _state.set_mode(LCDStatus::VBLANK);
+    int next = 0;
+    switch (_state.mode()) {
+        case LCDStatus::SEARCH_OAM:
+            _state.set_mode(LCDStatus::TRANSFER);
             _phase_changed = true;
-            _vblank_int = 1;
-            cevent << "vBLANK INT\n";
-        } else {
-            _state.set_mode(LCDStatus::SEARCH_OAM);
+            next = 172;
+            break;
+        case LCDStatus::TRANSFER:
+            _state.set_mode(LCDStatus::HBLANK);
             _phase_changed = true;
-        }
-    } else if (mode == LCDStatus::VBLANK && _clock == 456) {
-        ++_line;
-        _state.set_coincidence(_line == _ly_comp);
-        _clock = 0;
-    }
-    if (mode == LCDStatus::VBLANK && _line == 154) {
-        _render.Render();
-        _line = 0;
-        _clock = 0;
-        _state.set_mode(LCDStatus::SEARCH_OAM);
-        _phase_changed = true;
+            next = 204;
+            break;
+        case LCDStatus::HBLANK:
+            Render(_line);
+            ++_line;
+            _state.set_coincidence(_line == _ly_comp);
+            if (_line == 144) {
+                _state.set_mode(LCDStatus::VBLANK);
+                _phase_changed = true;
+                _vblank_int = 1;
+                cevent << "vBLANK INT\n";
+                next = 456;
+            } else {
+                _state.set_mode(LCDStatus::SEARCH_OAM);
+                _phase_changed = true;
+                next = 80;
+            }
+            break;
+        case LCDStatus::VBLANK:
+            ++_line;
+            _state.set_coincidence(_line == _ly_comp);
+            if (_line == 154) {
+                _render.Render();
+                _line = 0;
+                _state.set_mode(LCDStatus::SEARCH_OAM);
+                _phase_changed = true;
+                next = 80;
+            } else {
+                next = 456;
+            }
+            break;
     }
+    _sched.Schedule(Scheduler::PPU, _sched.deadline(Scheduler::PPU) + next);
 }
 
-int8_t Video::GetTilePix(Data8 tile, int32_t y, int32_t x) {
-    int32_t addr = 0;
-    if (_ctrl.tile_data_mode() == 0) {
-        addr = 0x9000 + tile.s * 16 + y * 2;
-    } else {
-        addr = 0x8000 + tile.u * 16 + y * 2;
-    }
+void Video::SaveState(StateWriter& w) const {
+    w.Write(_line);
+    w.Write(_ly_comp);
+    w.Write(_ctrl);
+    w.Write(_state);
+    w.Write(_vram);
+    w.Write(_oam);
+    // Cheaper to copy than to decode again
+    w.Write(_tiles);
+    w.Write(_scroll_x);
+    w.Write(_scroll_y);
+    w.Write(_wy);
+    w.Write(_wx);
+    w.Write(_bg_palette);
+    w.Write(_phase_changed);
+    w.Write(_vblank_int);
+    _sprites.SaveState(w);
+    _render.SaveState(w);
+}
 
-    int8_t l = (_vram[addr - 0x8000].u >> (7 - x)) & 1;
-    int8_t h = (_vram[addr + 1 - 0x8000].u >> (7 - x)) & 1;
-    return (h << 1) | l;
+void Video::LoadState(StateReader& r) {
+    r.Read(_line);
+    r.Read(_ly_comp);
+    r.Read(_ctrl);
+    r.Read(_state);
+    r.Read(_vram);
+    r.Read(_oam);
+    r.Read(_tiles);
+    r.Read(_scroll_x);
+    r.Read(_scroll_y);
+    r.Read(_wy);
+    r.Read(_wx);
+    r.Read(_bg_palette);
+    r.Read(_phase_changed);
+    r.Read(_vblank_int);
+    _sprites.LoadState(r);
+    _render.LoadState(r);
+    _sprites.UpdateAll();
 }
 
+// Both layers gather whole tile rows from the tile cache, then render the
+// line from the first visible pixel at once.
 void Video::RenderBg(int line) {
     const int y = (line + _scroll_y) % 256;
-    auto pixs = _render.pixs(line);
-
-    for (int px_num = 0; px_num < 160; ++px_num) {
-        const int x = (px_num + _scroll_x) % 256;
-        Data8 tile = bg_tilemap((x / 8) + (y / 8) * 32);
-        int color = GetTilePix(tile, y % 8, x % 8);
-
-        pixs[px_num].Render(
-            make_pixel(_bg_palette.GetColor(color), color == 0 ? 0 : 2));
+    byte colors[21 * 8];
+    for (int tile_nbr = 0; tile_nbr < 21; ++tile_nbr) {
+        const int x = (_scroll_x / 8 + tile_nbr) % 32;
+        Data8 tile = bg_tilemap(x + (y / 8) * 32);
+        memcpy(&colors[tile_nbr * 8], TileRow(tile, y % 8), 8);
     }
+    _render.RenderSpan(
+        line, 0, colors + _scroll_x % 8, 160, _bg_palette, 0, 2);
 }
 
 void Video::RenderWindow(int line) {
-    const int y = line;
-    auto pixs = _render.pixs(line);
-    for (int x = 0; x < 160; ++x) {
-        int y_win = y - _wy;
-        int x_win = x - _wx;
-        if (y_win < 0 || x_win < 0) {
-            continue;
-        }
-        Data8 tile = win_tilemap((x_win / 8) + (y_win / 8) * 32);
-        int color = GetTilePix(tile, y_win % 8, x_win % 8);
+    const int y_win = line - _wy;
+    if (y_win < 0) {
+        return;
+    }
 
-        pixs[x].Render(make_pixel(_bg_palette.GetColor(color), color ? 4 : 4));
+    // The window may start up to 7 pixels left of the screen
+    const int x = std::max(0, _wx);
+    const int skipped = x - _wx;
+    const int width = 160 - x;
+    if (width <= 0) {
+        return;
+    }
+    byte colors[21 * 8];
+    for (int tile_nbr = 0; tile_nbr < 21 && tile_nbr * 8 < skipped + width;
+         ++tile_nbr) {
+        Data8 tile = win_tilemap(tile_nbr + (y_win / 8) * 32);
+        memcpy(&colors[tile_nbr * 8], TileRow(tile, y_win % 8), 8);
     }
+    _render.RenderSpan(line, x, colors + skipped, width, _bg_palette, 4, 4);
 }
 
 void Video::Render(int line) {
+    ProfileScope scope(Profiler::RENDER);
     const int y = line;
     cdebug << "Y COORD: " << y << " " << _ctrl.bg_display() << "\n";
     assert(y < 144);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <algorithm>
 #include <array>
 #include <functional>
 #include <iomanip>
@@ -10,18 +11,25 @@
 #include "lcdstatus.h"
 #include "palette.h"
 #include "renderzone.h"
+#include "scheduler.h"
 #include "spritestable.h"
+#include "state.h"
+#include "tilecache.h"
 #include "utils.h"
 
 class Video {
    public:
-    Video() : _clock(0), _sprites(*this) {
+    Video(Scheduler& sched, Display& display)
+        : _sprites(*this), _render(display), _sched(sched) {
         _oam.fill(uint8_t(0));
         _vram.fill(uint8_t(0));
+        // Powers on in HBLANK
+        _sched.Schedule(Scheduler::PPU, 204);
     }
 
     void set_lcdc(byte b) {
         _ctrl.Set(b);
+        _sprites.UpdateHeight();
         cevent << "LCDC: " << std::hex << int(b)
                << "BG MAP: " << _ctrl.bg_tile_map_mode()
                << " DATA: " << _ctrl.tile_data_mode() << "\n";
@@ -35,11 +43,17 @@ class Video {
     void reset_y_coord() {
         _line = 0;
         _state.set_mode(LCDStatus::SEARCH_OAM);
-        _clock = 0;
+        _sched.Schedule(Scheduler::PPU, _sched.now() + 80);
     }
 
     byte vram(uint16_t idx) const { return _vram[idx - 0x8000u].u; }
-    void set_vram(uint16_t idx, byte val) { _vram[idx - 0x8000u].u = val; }
+    void set_vram(uint16_t idx, byte val) {
+        _vram[idx - 0x8000u].u = val;
+        if (idx < 0x9800) {
+            _tiles.Update(&_vram[0], idx - 0x8000u);
+        }
+    }
+    Data8* vram_ptr() { return &_vram[0]; }
 
     byte scroll_x() const { return _scroll_x; }
     void set_scroll_x(byte val) { _scroll_x = val; }
@@ -51,8 +65,19 @@ class Video {
     void set_ly_compare(byte v) { _ly_comp = v; }
 
     byte oam(uint16_t idx) const { return _oam[idx - 0xFE00u].u; }
-    void set_oam(uint16_t idx, byte v) { _oam[idx - 0xFE00u].u = v; }
+    void set_oam(uint16_t idx, byte v) {
+        _oam[idx - 0xFE00u].u = v;
+        // Y and X come first in each sprite's 4 bytes
+        if ((idx & 3) < 2) {
+            _sprites.UpdateSprite((idx - 0xFE00u) / 4);
+        }
+    }
     const Data8* oam_ptr() const { return &_oam[0]; }
+    // OAM DMA, copying the whole table at once
+    void CopyOam(const byte* src) {
+        std::copy(src, src + _oam.size(), &_oam[0].u);
+        _sprites.UpdateAll();
+    }
 
     byte win_y_pos() const { return _wy; }
     void set_win_y_pos(byte x) { _wy = x; }
@@ -81,10 +106,15 @@ class Video {
     byte obj1_palette() const { return _sprites.obj1_palette(); }
     void set_obj1_palette(byte x) { _sprites.set_obj1_palette(x); }
 
-    void Clock();
+    // Runs the mode transition that is due and schedules the next one.
+    // vblank_int() and stat_int() then tell which interrupts it raised.
+    void Step();
 
     RenderZone& render_zone() { return _render; }
-    void set_maxspeed(bool x) { _render.set_maxspeed(x); }
+    const TileCache& tiles() const { return _tiles; }
+
+    void SaveState(StateWriter& w) const;
+    void LoadState(StateReader& r);
 
    private:
     Data8 bg_tilemap(int tile_nbr) const {
@@ -97,20 +127,27 @@ class Video {
                      ((_ctrl.win_tile_map() ? 0x9C00 : 0x9800) - 0x8000)];
     }
 
-    int8_t GetTilePix(Data8 tile, int32_t y, int32_t x);
+    // Row y of a background or window tile
+    const byte* TileRow(Data8 tile, int y) const {
+        if (_ctrl.tile_data_mode() == 0) {
+            return _tiles.row(256 + tile.s, y);
+        } else {
+            return _tiles.row(tile.u, y);
+        }
+    }
 
     void Render(int line);
 
     void RenderBg(int line);
     void RenderWindow(int line);
 
-    int32_t _clock = 0;
     int32_t _line = 0;
     int32_t _ly_comp;
     LCDCtrl _ctrl;
     LCDStatus _state;
     std::array<Data8, 0xA000 - 0x8000> _vram;
     std::array<Data8, 0xFEA0 - 0xFE00> _oam;
+    TileCache _tiles;
     byte _scroll_x;
     byte _scroll_y;
     int _wy;
@@ -121,4 +158,5 @@ class Video {
 
     byte _vblank_int;
     RenderZone _render;
+    Scheduler& _sched;
 };
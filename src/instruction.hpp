@@ -8,13 +8,11 @@
 
 struct NextWord {
     static const int cycles = 8;
+    // Fetched along with the opcode
     static Data16 GetW(Z80* p) {
-        Data16 w;
         p->next_opcode();
-        w.bytes.l = p->addr().Get(p->pc().u);
         p->next_opcode();
-        w.bytes.h = p->addr().Get(p->pc().u);
-        return w;
+        return p->_imm;
     }
 
     static void Print(Z80* p) {
@@ -29,7 +27,7 @@ struct NextByte {
     static const int cycles = 4;
     static Data8 Get(Z80* p) {
         p->next_opcode();
-        return p->addr().Get(p->pc().u);
+        return p->_imm.bytes.l;
     }
     static void Print(Z80* p) {
         Data8 b = p->addr().Get(Z80::Register<Z80::PC>::GetW(p).u + 1);
@@ -37,7 +35,9 @@ struct NextByte {
     }
 };
 
-template <class Addr>
+// Memory operands trace their accesses when Tr, the tracing policy, asks for
+// it. Untraced, not even the address name is looked up.
+template <class Addr, class Tr>
 struct ToAddr {
     static const int cycles = 4 + Addr::cycles;
     static inline Data16 GetW(Z80* p) {
@@ -45,8 +45,11 @@ struct ToAddr {
         Data16 w;
         w.bytes.l = p->addr().Get(addr);
         w.bytes.h = p->addr().Get(addr + 1);
-        cinstr << std::hex << "read word " << w << " at " << std::hex << addr
-               << "(" << p->addr().Print(addr) << ")" << std::endl;
+        if (Tr::enabled) {
+            cinstr << std::hex << "read word " << w << " at " << std::hex
+                   << addr << "(" << p->addr().Print(addr) << ")"
+                   << std::endl;
+        }
         return w;
     }
 
@@ -54,23 +57,32 @@ struct ToAddr {
         auto addr = Addr::GetW(p).u;
         p->addr().Set(addr, uint8_t(val.u & 0xFF));
         p->addr().Set(addr + 1, uint8_t(val.u >> 8));
-        cinstr << std::hex << "set word " << val << " at " << std::hex << addr
-               << "(" << p->addr().Print(addr) << ")" << std::endl;
+        if (Tr::enabled) {
+            cinstr << std::hex << "set word " << val << " at " << std::hex
+                   << addr << "(" << p->addr().Print(addr) << ")"
+                   << std::endl;
+        }
     }
 
     static inline Data8 Get(Z80* p) {
         word addr = Addr::GetW(p).u;
         auto b = p->addr().Get(addr);
-        cinstr << std::hex << "  read byte " << b << " at " << std::hex << addr
-               << "(" << p->addr().Print(addr) << ")" << std::endl;
+        if (Tr::enabled) {
+            cinstr << std::hex << "  read byte " << b << " at " << std::hex
+                   << addr << "(" << p->addr().Print(addr) << ")"
+                   << std::endl;
+        }
         return b;
     }
 
     static inline void Set(Z80* p, Data8 val) {
         auto addr = Addr::GetW(p).u;
         p->addr().Set(addr, val);
-        cinstr << "  set byte " << std::hex << val << " at " << std::hex << addr
-               << "(" << p->addr().Print(addr) << ")" << std::endl;
+        if (Tr::enabled) {
+            cinstr << "  set byte " << std::hex << val << " at " << std::hex
+                   << addr << "(" << p->addr().Print(addr) << ")"
+                   << std::endl;
+        }
     }
 
     static void Print(Z80* p) {
@@ -80,7 +92,7 @@ struct ToAddr {
     }
 };
 
-template <class Addr>
+template <class Addr, class Tr>
 struct ToAddrFF00 {
     static const int cycles = 4 + Addr::cycles;
     static inline Data8 Get(Z80* p) {
@@ -88,8 +100,10 @@ struct ToAddrFF00 {
         auto addr = 0xFF00 + offset.u;
         auto b = p->addr().Get(addr);
 
-        cinstr << std::hex << "  read byte " << int(b.u) << " at " << addr
-               << "(" << p->addr().Print(addr) << ")" << std::endl;
+        if (Tr::enabled) {
+            cinstr << std::hex << "  read byte " << int(b.u) << " at " << addr
+                   << "(" << p->addr().Print(addr) << ")" << std::endl;
+        }
 
         return b;
     }
@@ -98,8 +112,10 @@ struct ToAddrFF00 {
         Data8 offset = Addr::Get(p);
         auto addr = 0xFF00 + offset.u;
         p->addr().Set(addr, val);
-        cinstr << std::hex << "  set byte " << int(val.u) << " at " << addr
-               << "(" << p->addr().Print(addr) << ")" << std::endl;
+        if (Tr::enabled) {
+            cinstr << std::hex << "  set byte " << int(val.u) << " at " << addr
+                   << "(" << p->addr().Print(addr) << ")" << std::endl;
+        }
     }
 
     static void Print(Z80* p) {
@@ -121,27 +137,28 @@ template <class, class>
 struct DAA {
     static int Do(Z80* p) {
         int16_t a = Z80::Register<Z80::A>::Get(p).u;
-        if (!p->sub_f()) {
-            if ((a & 0x0F) > 9 || p->hcarry_f()) {
+        byte f = p->flags();
+        if (!GetBit(f, 6)) {
+            if ((a & 0x0F) > 9 || GetBit(f, 5)) {
                 a += 6;
             }
-            if (a > 0x9F || p->carry_f()) {
+            if (a > 0x9F || GetBit(f, 4)) {
                 a += 0x60;
-                p->set_carry_f(true);
+                f = SetBit(f, 4);
             }
         } else {
-            if (p->hcarry_f()) {
+            if (GetBit(f, 5)) {
                 a = (a - 6) & 0xFF;
             }
-            if (p->carry_f()) {
+            if (GetBit(f, 4)) {
                 a -= 0x60;
             }
         }
-        p->set_hcarry_f(false);
-        p->set_zero_f((a & 0xff) == 0);
+        f = (f & 0x50) | ((a & 0xff) == 0) << 7;
         if (a >> 8) {
-            p->set_carry_f(true);
+            f = SetBit(f, 4);
         }
+        p->set_flags(f);
         Z80::Register<Z80::A>::Set(p, int8_t(a & 0xFF));
         p->next_opcode();
         return 4;
@@ -157,10 +174,7 @@ struct RLC {
 
         res.u = (res.u << 1) | ((res.u >> 7) & 1);
 
-        p->set_zero_f(res.u == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(res.u & 1);
+        p->set_flags((res.u == 0) << 7 | (res.u & 1) << 4);
 
         Val::Set(p, res);
         p->next_opcode();
@@ -181,10 +195,7 @@ struct RLCA {
 
         res.u = (res.u << 1) | ((res.u >> 7) & 1);
 
-        p->set_zero_f(false);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(res.u & 1);
+        p->set_flags((res.u & 1) << 4);
 
         Z80::Register<Z80::A>::Set(p, res);
         p->next_opcode();
@@ -201,10 +212,7 @@ struct RRC {
 
         res.u = (res.u >> 1) | ((res.u & 1) << 7);
 
-        p->set_zero_f(res.u == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(res.u >> 7);
+        p->set_flags((res.u == 0) << 7 | (res.u >> 7) << 4);
 
         Val::Set(p, res);
         p->next_opcode();
@@ -226,10 +234,7 @@ struct RRCA {
         int c = res.u & 1;
         res.u = (res.u >> 1) | (c << 7);
 
-        p->set_zero_f(false);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(c);
+        p->set_flags(c << 4);
 
         Z80::Register<Z80::A>::Set(p, res);
         p->next_opcode();
@@ -244,14 +249,11 @@ struct RL {
     static int Do(Z80* p) {
         Data8 res = Val::Get(p);
         int c = p->carry_f();
-
-        p->set_carry_f(res.u >> 7);
+        int out = res.u >> 7;
 
         res.u = res.u << 1 | c;
 
-        p->set_zero_f(res.u == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
+        p->set_flags((res.u == 0) << 7 | out << 4);
 
         Val::Set(p, res);
         p->next_opcode();
@@ -271,14 +273,10 @@ struct RLA {
         Data8 res = Z80::Register<Z80::A>::Get(p);
         int c = p->carry_f();
 
-        p->set_carry_f(res.u >> 7);
+        p->set_flags((res.u >> 7) << 4);
 
         res.u = res.u << 1 | c;
 
-        p->set_zero_f(false);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-
         Z80::Register<Z80::A>::Set(p, res);
         p->next_opcode();
         return 4;
@@ -292,15 +290,12 @@ struct RR {
     static int Do(Z80* p) {
         Data8 res = Val::Get(p);
         int c = p->carry_f() ? 1 : 0;
-
-        p->set_carry_f(GetBit(res.u, 0));
+        int out = res.u & 1;
 
         res.u = res.u >> 1;
         res.u = WriteBit(res.u, 7, c);
 
-        p->set_zero_f(res.u == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
+        p->set_flags((res.u == 0) << 7 | out << 4);
 
         Val::Set(p, res);
         p->next_opcode();
@@ -319,13 +314,10 @@ struct RRA {
         Data8 res = Z80::Register<Z80::A>::Get(p);
         int c = p->carry_f();
 
-        p->set_carry_f(GetBit(res.u, 0));
+        p->set_flags((res.u & 1) << 4);
 
         res.u = res.u >> 1;
         res.u = WriteBit(res.u, 7, c);
-        p->set_zero_f(false);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
 
         Z80::Register<Z80::A>::Set(p, res);
         p->next_opcode();
@@ -371,9 +363,8 @@ struct SET {
 template <class Bit, class R>
 struct BIT {
     static int Do(Z80* p) {
-        p->set_zero_f(!(R::Get(p).u & (1 << Bit::Get().u)));
-        p->set_sub_f(0);
-        p->set_hcarry_f(1);
+        bool zero = !(R::Get(p).u & (1 << Bit::Get().u));
+        p->set_flags(zero << 7 | 0x20 | (p->flags() & 0x10));
         p->next_opcode();
         return 8 + R::cycles;
     }
@@ -391,8 +382,7 @@ struct CPL {
         uint8_t r = 0xFF ^ A::Get(p).u;
         A::Set(p, r);
 
-        p->set_sub_f(1);
-        p->set_hcarry_f(1);
+        p->set_flags(p->flags() | 0x60);
         p->next_opcode();
         return 4;
     }
@@ -407,9 +397,7 @@ struct CPL {
 template <class A, class>
 struct SCF {
     static inline int Do(Z80* p) {
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(true);
+        p->set_flags((p->flags() & 0x80) | 0x10);
         p->next_opcode();
         return 4;
     }
@@ -422,9 +410,7 @@ struct SCF {
 template <class A, class>
 struct CCF {
     static inline int Do(Z80* p) {
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(!p->carry_f());
+        p->set_flags((p->flags() & 0x90) ^ 0x10);
         p->next_opcode();
         return 4;
     }
@@ -438,12 +424,11 @@ template <class Val, class>
 struct INC {
     static inline int Do(Z80* p) {
         Data8 res = Val::Get(p);
-        p->set_hcarry_f((res.u & 0xf) == 0xf);
+        uint8_t a = res.u;
         ++res.u;
         Val::Set(p, res);
 
-        p->set_zero_f(res.u == 0);
-        p->set_sub_f(false);
+        p->set_add_flags(a, 1, res.u | p->carry_f() << 8);
         p->next_opcode();
         return 4 + 2 * Val::cycles;
     }
@@ -474,12 +459,11 @@ template <class Val, class>
 struct DEC {
     static inline int Do(Z80* p) {
         Data8 res = Val::Get(p);
-        p->set_hcarry_f((res.u & 0xf) == 0);
+        uint8_t a = res.u;
         --res.u;
         Val::Set(p, res);
 
-        p->set_zero_f(res.u == 0);
-        p->set_sub_f(1);
+        p->set_sub_flags(a, 1, res.u | p->carry_f() << 8);
         p->next_opcode();
         return 4 + 2 * Val::cycles;
     }
@@ -515,10 +499,7 @@ struct ADD {
         Data8 b = B::Get(p);
         uint16_t res = a.u + b.u;
 
-        p->set_zero_f((res & 0xFF) == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(((a.u & 0xf) + (b.u & 0xf)) >> 4);
-        p->set_carry_f(res >> 8);
+        p->set_add_flags(a.u, b.u, res);
 
         A::Set(p, uint8_t(res & 0xFF));
         p->next_opcode();
@@ -541,9 +522,8 @@ struct ADDw {
         Data16 b = B::GetW(p);
         uint32_t res = a.u + b.u;
 
-        p->set_sub_f(false);
-        p->set_hcarry_f(((a.u & 0xFFF) + (b.u & 0xFFF)) >> 12);
-        p->set_carry_f(res >> 16);
+        int h = ((a.u & 0xFFF) + (b.u & 0xFFF)) >> 12;
+        p->set_flags((p->flags() & 0x80) | h << 5 | (res >> 16) << 4);
 
         A::SetW(p, uint16_t(res & 0xFFFF));
         p->next_opcode();
@@ -568,10 +548,9 @@ struct ADDO {
         int r = a.s + b.s;
         res.u = r;
 
-        p->set_zero_f(false);
-        p->set_sub_f(false);
-        p->set_hcarry_f(((a.u & 0xf) + (b.u & 0xf)) >> 4);
-        p->set_carry_f(((a.u & 0xff) + (b.u & 0xff)) >> 8);
+        int h = ((a.u & 0xf) + (b.u & 0xf)) >> 4;
+        int c = ((a.u & 0xff) + (b.u & 0xff)) >> 8;
+        p->set_flags(h << 5 | c << 4);
 
         A::SetW(p, res);
         p->next_opcode();
@@ -594,10 +573,7 @@ struct ADC {
         Data8 b = B::Get(p);
         uint16_t res = a.u + b.u + p->carry_f();
 
-        p->set_zero_f((res & 0xFF) == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(((a.u & 0xf) + (b.u & 0xf) + p->carry_f()) >> 4);
-        p->set_carry_f(res >> 8);
+        p->set_add_flags(a.u, b.u, res);
 
         A::Set(p, uint8_t(res & 0xFF));
         p->next_opcode();
@@ -622,10 +598,7 @@ struct SUB {
         int r = a.u - b.u;
         res.s = r;
 
-        p->set_zero_f(res.u == 0);
-        p->set_hcarry_f((a.s ^ b.s ^ res.s) & 0x10);
-        p->set_sub_f(true);
-        p->set_carry_f(r & 0x100);
+        p->set_sub_flags(a.u, b.u, r);
 
         A::Set(p, res);
         p->next_opcode();
@@ -650,10 +623,7 @@ struct SBC {
         int r = a.u - b.u - p->carry_f();
         res.u = r;
 
-        p->set_zero_f(res.u == 0);
-        p->set_hcarry_f((a.u ^ b.u ^ r) & 0x10);
-        p->set_sub_f(true);
-        p->set_carry_f(r & 0x100);
+        p->set_sub_flags(a.u, b.u, r);
 
         A::Set(p, res);
         p->next_opcode();
@@ -674,10 +644,7 @@ struct AND {
     static int Do(Z80* p) {
         uint8_t res = A::Get(p).u & B::Get(p).u;
 
-        p->set_zero_f(res == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(true);
-        p->set_carry_f(false);
+        p->set_flags((res == 0) << 7 | 0x20);
 
         A::Set(p, res);
         p->next_opcode();
@@ -698,10 +665,7 @@ struct XOR {
     static int Do(Z80* p) {
         uint8_t res = A::Get(p).u ^ B::Get(p).u;
 
-        p->set_zero_f(res == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(false);
+        p->set_flags((res == 0) << 7);
 
         A::Set(p, res);
         p->next_opcode();
@@ -722,10 +686,7 @@ struct OR {
     static int Do(Z80* p) {
         uint8_t res = A::Get(p).u | B::Get(p).u;
 
-        p->set_zero_f(res == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(false);
+        p->set_flags((res == 0) << 7);
 
         A::Set(p, res);
         p->next_opcode();
@@ -746,13 +707,11 @@ struct SRL {
     static int Do(Z80* p) {
         Data8 a = A::Get(p);
 
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(a.u & 1);
+        int out = a.u & 1;
 
         a.u = (a.u >> 1);
         a.u = ClearBit(a.u, 7);
-        p->set_zero_f(a.u == 0);
+        p->set_flags((a.u == 0) << 7 | out << 4);
 
         A::Set(p, a);
         p->next_opcode();
@@ -770,12 +729,10 @@ struct SLA {
     static int Do(Z80* p) {
         Data8 a = A::Get(p);
 
-        p->set_carry_f(GetBit(a.u, 7));
+        int out = GetBit(a.u, 7);
 
         a.u = a.u << 1;
-        p->set_zero_f(a.u == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
+        p->set_flags((a.u == 0) << 7 | out << 4);
 
         A::Set(p, a);
         p->next_opcode();
@@ -793,13 +750,11 @@ struct SRA {
     static int Do(Z80* p) {
         Data8 a = A::Get(p);
 
-        p->set_carry_f(GetBit(a.u, 0));
+        int out = GetBit(a.u, 0);
 
         a.u = a.u >> 1;
         a.u = SetBit(a.u, 7, GetBit(a.u, 6));
-        p->set_zero_f(a.u == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
+        p->set_flags((a.u == 0) << 7 | out << 4);
 
         A::Set(p, a);
         p->next_opcode();
@@ -817,14 +772,9 @@ struct CP {
     static int Do(Z80* p) {
         Data8 a = A::Get(p);
         Data8 b = B::Get(p);
-        Data8 res;
         int r = a.u - b.u;
-        res.s = r;
 
-        p->set_zero_f(res.u == 0);
-        p->set_hcarry_f((a.s ^ b.s ^ res.s) & 0x10);
-        p->set_sub_f(true);
-        p->set_carry_f(r & 0x100);
+        p->set_sub_flags(a.u, b.u, r);
 
         p->next_opcode();
         return 4 + A::cycles + B::cycles;
@@ -846,10 +796,7 @@ struct SWAP {
 
         res.u = (res.u << 4) | (res.u >> 4);
         A::Set(p, res);
-        p->set_zero_f(res.u == 0);
-        p->set_sub_f(false);
-        p->set_hcarry_f(false);
-        p->set_carry_f(false);
+        p->set_flags((res.u == 0) << 7);
         p->next_opcode();
         return 8 + 2 * A::cycles;
     }
@@ -860,10 +807,12 @@ struct SWAP {
     }
 };
 
-template <class A, class>
+// Actions going through the stack have no second operand, its slot carries
+// the tracing policy instead.
+template <class A, class Tr>
 struct POP {
     static int Do(Z80* p) {
-        A::SetW(p, ToAddr<Z80::Register<Z80::SP>>::GetW(p));
+        A::SetW(p, ToAddr<Z80::Register<Z80::SP>, Tr>::GetW(p));
         Data16 sp = Z80::Register<Z80::SP>::GetW(p);
         sp.u += 2;
         Z80::Register<Z80::SP>::SetW(p, sp);
@@ -942,11 +891,11 @@ using JRC = JR_Impl<IfC, A, B>;
 template <class A, class B>
 using JRNC = JR_Impl<NC, A, B>;
 
-template <class Test, class A, class fghdl>
+template <class Test, class A, class Tr>
 struct RET_Impl {
     static int Do(Z80* p) {
         if (Test::Do(p)) {
-            POP<Z80::Register<Z80::PC>, void>::Do(p);
+            POP<Z80::Register<Z80::PC>, Tr>::Do(p);
             --p->pc().u;
             return std::conditional_t<std::is_same<Test, True>::value,
                                       I<16>,
@@ -1015,13 +964,13 @@ using JPC = JP_Impl<IfC, A, B>;
 template <class A, class B>
 using JPNC = JP_Impl<NC, A, B>;
 
-template <class A, class>
+template <class A, class Tr>
 struct PUSH {
     static int Do(Z80* p) {
         Data16 sp = Z80::Register<Z80::SP>::GetW(p);
         sp.u -= 2;
         Z80::Register<Z80::SP>::SetW(p, sp);
-        ToAddr<Z80::Register<Z80::SP>>::SetW(p, A::GetW(p));
+        ToAddr<Z80::Register<Z80::SP>, Tr>::SetW(p, A::GetW(p));
         p->next_opcode();
         return 16;
     }
@@ -1032,14 +981,14 @@ struct PUSH {
     }
 };
 
-template <class Test, class A, class>
+template <class Test, class A, class Tr>
 struct CALL_Impl {
     static int Do(Z80* p) {
         Data16 addr = A::GetW(p);
         if (Test::Do(p)) {
             p->next_opcode();  // move PAST the CALL so that we save the
                                // instruction right after it
-            PUSH<Z80::Register<Z80::PC>, void>::Do(p);
+            PUSH<Z80::Register<Z80::PC>, Tr>::Do(p);
 
             Z80::Register<Z80::PC>::SetW(p, addr);
             return 24;
@@ -1097,6 +1046,12 @@ struct LD {
     }
 };
 
+template <class A>
+struct IsToNextWord : std::false_type {};
+
+template <class Tr>
+struct IsToNextWord<ToAddr<NextWord, Tr>> : std::true_type {};
+
 template <class A, class B>
 struct LDw {
     static inline int Do(Z80* proc) {
@@ -1105,7 +1060,7 @@ struct LDw {
         if (std::is_same<A, Z80::Register<Z80::SP>>::value &&
             std::is_same<B, Z80::Register<Z80::HL>>::value) {
             return 8;
-        } else if (std::is_same<A, ToAddr<NextWord>>::value &&
+        } else if (IsToNextWord<A>::value &&
                    std::is_same<B, Z80::Register<Z80::SP>>::value) {
             return 20;
         } else {
@@ -1127,10 +1082,8 @@ struct LDHLSPN {
         Data16 a = Z80::Register<Z80::SP>::GetW(p);
         Data8 offset = NextByte::Get(p);
         int res = a.u + offset.s;
-        p->set_zero_f(false);
-        p->set_sub_f(false);
-        p->set_hcarry_f((a.u ^ offset.s ^ res) & 0x10);
-        p->set_carry_f((a.u ^ offset.s ^ res) & 0x100);
+        int carries = a.u ^ offset.s ^ res;
+        p->set_flags(((carries & 0x10) << 1) | ((carries & 0x100) >> 4));
         a.u = res;
         Z80::Register<Z80::HL>::SetW(p, a);
         p->next_opcode();
@@ -1148,11 +1101,11 @@ struct LDHLSPN {
 template <class A, class B>
 struct LDD;
 
-template <class A, class B>
-struct LDD<ToAddr<A>, B> {
+template <class A, class Tr, class B>
+struct LDD<ToAddr<A, Tr>, B> {
     static inline int Do(Z80* proc) {
         Data16 addr = A::GetW(proc);
-        ToAddr<A>::Set(proc, B::Get(proc));
+        ToAddr<A, Tr>::Set(proc, B::Get(proc));
         --addr.u;
         A::SetW(proc, addr);
         proc->next_opcode();
@@ -1167,8 +1120,8 @@ struct LDD<ToAddr<A>, B> {
     }
 };
 
-template <class A, class B>
-struct LDD<A, ToAddr<B>> {
+template <class A, class B, class Tr>
+struct LDD<A, ToAddr<B, Tr>> {
     static inline int Do(Z80* proc) {
         Data16 addr = B::GetW(proc);
         A::Set(proc, proc->addr().Get(addr.u));
@@ -1181,7 +1134,7 @@ struct LDD<A, ToAddr<B>> {
         cinstr << "ldd ";
         A::Print(p);
         cinstr << ", ";
-        ToAddr<B>::Print(p);
+        ToAddr<B, Tr>::Print(p);
         cinstr << std::endl;
     }
 };
@@ -1189,8 +1142,8 @@ struct LDD<A, ToAddr<B>> {
 template <class A, class B>
 struct LDI;
 
-template <class A, class B>
-struct LDI<ToAddr<A>, B> {
+template <class A, class Tr, class B>
+struct LDI<ToAddr<A, Tr>, B> {
     static inline int Do(Z80* proc) {
         Data16 addr = A::GetW(proc);
         proc->addr().Set(addr.u, B::Get(proc));
@@ -1201,15 +1154,15 @@ struct LDI<ToAddr<A>, B> {
     }
     static void Print(Z80* p) {
         cinstr << "ldi ";
-        ToAddr<A>::Print(p);
+        ToAddr<A, Tr>::Print(p);
         cinstr << ", ";
         B::Print(p);
         cinstr << std::endl;
     }
 };
 
-template <class A, class B>
-struct LDI<A, ToAddr<B>> {
+template <class A, class B, class Tr>
+struct LDI<A, ToAddr<B, Tr>> {
     static inline int Do(Z80* proc) {
         Data16 addr = B::GetW(proc);
         A::Set(proc, proc->addr().Get(addr.u));
@@ -1222,7 +1175,7 @@ struct LDI<A, ToAddr<B>> {
         cinstr << "ldi ";
         A::Print(p);
         cinstr << ", ";
-        ToAddr<B>::Print(p);
+        ToAddr<B, Tr>::Print(p);
         cinstr << std::endl;
     }
 };
@@ -1265,20 +1218,22 @@ struct HALT {
     static void Print(Z80*) { cinstr << "halt" << std::endl; }
 };
 
-template <uint16_t Addr, bool HasOpcode, class, class>
+template <uint16_t Addr, bool HasOpcode, class, class Tr>
 struct RST_Impl {
     static int Do(Z80* p) {
         if (HasOpcode) {
             p->next_opcode();
         } else {
-            cinstr << "INT 0x" << std::hex << Addr << std::endl;
+            if (Tr::enabled) {
+                cinstr << "INT 0x" << std::hex << Addr << std::endl;
+            }
             p->set_interrupts(0x00);
             p->next_opcode();
         }
         Data16 sp = Z80::Register<Z80::SP>::GetW(p);
         sp.u -= 2;
         Z80::Register<Z80::SP>::SetW(p, sp);
-        ToAddr<Z80::Register<Z80::SP>>::SetW(p, p->pc());
+        ToAddr<Z80::Register<Z80::SP>, Tr>::SetW(p, p->pc());
 
         Z80::Register<Z80::PC>::SetW(p, Addr);
         if (HasOpcode) {
@@ -1331,11 +1286,11 @@ using RST58 = RST_Impl<0x58, false, A, B>;
 template <class A, class B>
 using RST60 = RST_Impl<0x60, false, A, B>;
 
-template <class, class>
+template <class, class Tr>
 struct RETI {
     static inline int Do(Z80* p) {
         p->set_interrupts(0xFF);
-        RET<void, void>::Do(p);
+        RET<void, Tr>::Do(p);
         return 16;
     }
     static void Print(Z80*) { cinstr << "reti" << std::endl; }
@@ -1344,18 +1299,17 @@ struct RETI {
 template <class, class>
 struct STOP {
     static inline int Do(Z80* p) {
-        HALT<void, void>::Do(p);
+        p->set_stop(true);
+        p->next_opcode();
         return 4;
     }
     static void Print(Z80*) { cinstr << "stop" << std::endl; }
 };
 
-template <class, class>
+template <class, class Tr>
 struct EXTENDED {
     static inline int Do(Z80* p) {
-        p->next_opcode();
-        return p->RunCBOpcode(
-            p->addr().Get(Z80::Register<Z80::PC>::GetW(p).u).u);
+        return p->RunCBOpcode<Tr>(NextByte::Get(p).u);
     }
     static void Print(Z80* p) {
         cinstr << std::hex << int(p->addr().Get(p->pc().u + 1).u) << " ";
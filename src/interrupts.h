@@ -0,0 +1,62 @@
+#pragma once
+
+#include "state.h"
+
+// IF, IE and IME. The interrupts to service are recomputed whenever one of
+// them changes, so that the CPU only tests pending() between instructions.
+class Interrupts {
+   public:
+    using byte = unsigned char;
+
+    // Bits of IF and IE, in priority order
+    enum Source { VBLANK, STAT, TIMER, SERIAL, JOYPAD };
+
+    Interrupts() : _flags(0), _enable(0), _master(true), _pending(0) {}
+
+    // IF, at 0xFF0F
+    byte flags() const { return _flags; }
+    void set_flags(byte v) {
+        _flags = v;
+        Update();
+    }
+    void Request(Source s) { set_flags(_flags | (1 << s)); }
+    void Acknowledge(Source s) { set_flags(_flags & ~(1 << s)); }
+
+    // IE, at 0xFFFF
+    byte enable() const { return _enable; }
+    void set_enable(byte v) {
+        _enable = v;
+        Update();
+    }
+
+    // IME, set by EI and RETI, cleared by DI and when servicing
+    bool master_enable() const { return _master; }
+    void set_master_enable(bool v) {
+        _master = v;
+        Update();
+    }
+
+    // Requested and enabled interrupts, none while IME is clear
+    byte pending() const { return _pending; }
+
+    void SaveState(StateWriter& w) const {
+        w.Write(_flags);
+        w.Write(_enable);
+        w.Write(_master);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_flags);
+        r.Read(_enable);
+        r.Read(_master);
+        Update();
+    }
+
+   private:
+    // Bits 5-7 match no source, and must not stop the CPU
+    void Update() { _pending = _master ? _flags & _enable & 0x1F : 0; }
+
+    byte _flags;
+    byte _enable;
+    bool _master;
+    byte _pending;
+};
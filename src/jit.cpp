@@ -0,0 +1,793 @@
+#include "jit.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__x86_64__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "addressbus.h"
+#include "z80.h"
+
+#if defined(__x86_64__)
+
+static const size_t kCodeSize = 16 << 20;
+
+namespace {
+
+enum HostReg {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// Where the guest registers live in native code, indexed like Z80::_regs.
+// RDI points to _regs and RSI to the NativeExit. RDX points to the plain
+// memory, whose addresses are built into the code instead, so RAX, RCX, RDX
+// and RBX are scratch.
+const HostReg kGuest[8] = {R8, R9, R10, R11, R12, R13, R15, R14};
+enum GuestReg { kB, kC, kD, kE, kH, kL, kF, kA };
+
+enum Cond { kEqual = 4, kNotEqual = 5 };
+enum AluOp { kAdd, kOr, kAdc, kSbb, kAnd, kSub, kXor, kCmp };
+
+// The few x86-64 instructions translations are made of. Operands are 32 bits
+// wide unless the name says otherwise.
+class Assembler {
+   public:
+    const std::vector<byte>& code() const { return _code; }
+    size_t size() const { return _code.size(); }
+    void Truncate(size_t size) { _code.resize(size); }
+
+    void Mov(int dst, int src) {
+        Rex(src, dst);
+        Emit(0x89);
+        ModRM(3, src, dst);
+    }
+    void MovI(int dst, uint32_t imm) {
+        Rex(0, dst);
+        Emit(0xB8 + (dst & 7));
+        Emit32(imm);
+    }
+    void MovQI(int dst, const void* imm) {
+        Rex(0, dst, true);
+        Emit(0xB8 + (dst & 7));
+        uint64_t x = reinterpret_cast<uintptr_t>(imm);
+        Emit32(uint32_t(x));
+        Emit32(uint32_t(x >> 32));
+    }
+    void Alu(AluOp op, int dst, int src) {
+        Rex(src, dst);
+        Emit(op * 8 + 1);
+        ModRM(3, src, dst);
+    }
+    void AluI(AluOp op, int dst, uint32_t imm) {
+        Rex(0, dst);
+        Emit(0x81);
+        ModRM(3, op, dst);
+        Emit32(imm);
+    }
+    void AddQ(int dst, int src) {
+        Rex(src, dst, true);
+        Emit(0x01);
+        ModRM(3, src, dst);
+    }
+    void AddQI(int dst, uint32_t imm) {
+        Rex(0, dst, true);
+        Emit(0x81);
+        ModRM(3, kAdd, dst);
+        Emit32(imm);
+    }
+    void Shl(int dst, int n) { Shift(4, dst, n); }
+    void Shr(int dst, int n) { Shift(5, dst, n); }
+    void TestI(int dst, uint32_t imm) {
+        Rex(0, dst);
+        Emit(0xF7);
+        ModRM(3, 0, dst);
+        Emit32(imm);
+    }
+    void Test(int a, int b) {
+        Rex(b, a);
+        Emit(0x85);
+        ModRM(3, b, a);
+    }
+    void TestQ(int a) {
+        Rex(a, a, true);
+        Emit(0x85);
+        ModRM(3, a, a);
+    }
+    // dst = cond ? 1 : 0, for dst in RAX to RBX
+    void Set(Cond cond, int dst) {
+        Emit(0x0F);
+        Emit(0x90 + cond);
+        ModRM(3, 0, dst);
+        Emit(0x0F);
+        Emit(0xB6);
+        ModRM(3, dst, dst);
+    }
+
+    // Memory operands, based on RAX to RBX only
+    void LoadQ(int dst, int base) {
+        Rex(dst, base, true);
+        Emit(0x8B);
+        ModRM(0, dst, base);
+    }
+    // dst = [base + index * 8]
+    void LoadQIndexed(int dst, int base, int index) {
+        Rex(dst, base, true, index);
+        Emit(0x8B);
+        ModRM(0, dst, 4);
+        Emit(0xC0 | (index & 7) << 3 | (base & 7));
+    }
+    void Load8(int dst, int base) {
+        Rex(dst, base);
+        Emit(0x0F);
+        Emit(0xB6);
+        ModRM(0, dst, base);
+    }
+    void Store8(int base, int src) {
+        Rex(src, base, false, 0, src >= RSP);
+        Emit(0x88);
+        ModRM(0, src, base);
+    }
+    void Cmp8I(int base, byte imm) {
+        Emit(0x80);
+        ModRM(0, kCmp, base);
+        Emit(imm);
+    }
+
+    // Byte i of the guest register file, at RDI
+    void LoadGuest(int dst, int i) {
+        Rex(dst, RDI);
+        Emit(0x0F);
+        Emit(0xB6);
+        ModRM(1, dst, RDI);
+        Emit(i);
+    }
+    void StoreGuest(int i, int src) {
+        Rex(src, RDI, false, 0, src >= RSP);
+        Emit(0x88);
+        ModRM(1, src, RDI);
+        Emit(i);
+    }
+    // 32 bits field at offset of the NativeExit, at RSI
+    void StoreExit(int offset, uint32_t imm) {
+        Emit(0xC7);
+        ModRM(1, 0, RSI);
+        Emit(offset);
+        Emit32(imm);
+    }
+    void StoreExitReg(int offset, int src) {
+        Rex(src, RSI);
+        Emit(0x89);
+        ModRM(1, src, RSI);
+        Emit(offset);
+    }
+
+    void Push(int r) {
+        Rex(0, r);
+        Emit(0x50 + (r & 7));
+    }
+    void Pop(int r) {
+        Rex(0, r);
+        Emit(0x58 + (r & 7));
+    }
+    void Ret() { Emit(0xC3); }
+
+    // Forward jumps return where their displacement is, for Bind
+    size_t Jump(Cond cond) {
+        Emit(0x0F);
+        Emit(0x80 + cond);
+        Emit32(0);
+        return _code.size() - 4;
+    }
+    size_t Jump() {
+        Emit(0xE9);
+        Emit32(0);
+        return _code.size() - 4;
+    }
+    // Makes the jump land here
+    void Bind(size_t jump) {
+        uint32_t rel = uint32_t(_code.size() - (jump + 4));
+        std::memcpy(&_code[jump], &rel, 4);
+    }
+    void JumpBack(size_t target) {
+        Emit(0xE9);
+        Emit32(uint32_t(target - (_code.size() + 4)));
+    }
+
+   private:
+    void Shift(int ext, int dst, int n) {
+        Rex(0, dst);
+        Emit(0xC1);
+        ModRM(3, ext, dst);
+        Emit(n);
+    }
+    // Byte registers 4 to 7 are SPL to DIL only with a REX prefix
+    void Rex(int reg, int rm, bool wide = false, int index = 0,
+             bool force = false) {
+        byte rex = 0x40 | wide << 3 | (reg >> 3) << 2 | (index >> 3) << 1 |
+                   (rm >> 3);
+        if (rex != 0x40 || force) {
+            Emit(rex);
+        }
+    }
+    void ModRM(int mod, int reg, int rm) {
+        Emit(mod << 6 | (reg & 7) << 3 | (rm & 7));
+    }
+    void Emit(byte b) { _code.push_back(b); }
+    void Emit32(uint32_t x) {
+        for (int i = 0; i < 4; ++i) {
+            Emit(x >> (8 * i));
+        }
+    }
+
+    std::vector<byte> _code;
+};
+
+typedef AddressBus::PlainMemory Memory;
+
+// Translates one block, instruction by instruction. Each instruction checks
+// its memory accesses before changing anything, so that it can bail out to
+// the interpreter as if native code stopped right before it.
+class Translator {
+   public:
+    explicit Translator(const Memory& mem) : _mem(mem) {}
+
+    std::vector<byte> Translate(const BlockCache::Block& block, int* span) {
+        _as.Push(RBX);
+        _as.Push(R12);
+        _as.Push(R13);
+        _as.Push(R14);
+        _as.Push(R15);
+        for (int i = 0; i < 8; ++i) {
+            _as.LoadGuest(kGuest[i], i);
+        }
+
+        _cycles = 0;
+        _n = 0;
+        *span = 0;
+        bool branched = false;
+        for (const BlockCache::Op& op : block.ops) {
+            const size_t start = _as.size();
+            _pc = op.pc;
+            _bails.clear();
+            int cycles = Branch(op);
+            branched = cycles != 0;
+            if (!branched) {
+                cycles = Instruction(op);
+            }
+            if (cycles == 0) {
+                _as.Truncate(start);
+                break;
+            }
+            if (!_bails.empty()) {
+                _stubs.push_back({_bails, _pc, _n, _cycles});
+            }
+            *span = _cycles;
+            _cycles += cycles;
+            ++_n;
+            if (branched) {
+                break;
+            }
+        }
+        if (_n == 0) {
+            return {};
+        }
+        if (!branched) {
+            const BlockCache::Op& last = block.ops[_n - 1];
+            _as.StoreExit(0, last.pc + Z80::length(last.opcode));
+            _as.StoreExit(4, _n);
+            _as.MovI(RAX, _cycles);
+        }
+
+        const size_t epilogue = _as.size();
+        for (size_t jump : _to_epilogue) {
+            _as.Bind(jump);
+        }
+        for (int i = 0; i < 8; ++i) {
+            _as.StoreGuest(i, kGuest[i]);
+        }
+        _as.Pop(R15);
+        _as.Pop(R14);
+        _as.Pop(R13);
+        _as.Pop(R12);
+        _as.Pop(RBX);
+        _as.Ret();
+
+        for (const Stub& stub : _stubs) {
+            for (size_t jump : stub.jumps) {
+                _as.Bind(jump);
+            }
+            _as.StoreExit(0, stub.pc);
+            _as.StoreExit(4, stub.n);
+            _as.MovI(RAX, stub.cycles);
+            _as.JumpBack(epilogue);
+        }
+        return _as.code();
+    }
+
+   private:
+    struct Stub {
+        std::vector<size_t> jumps;
+        uint16_t pc;
+        int n;
+        int cycles;
+    };
+
+    // A flag is either left alone, cleared, set, or copied from a register
+    // holding 0 or 1.
+    enum FlagOp { kKeep = -3, kClear = -2, kSet = -1 };
+
+    // Stops before the current instruction if cond holds
+    void BailIf(Cond cond) { _bails.push_back(_as.Jump(cond)); }
+
+    void SetFlags(int z, int n, int h, int c) {
+        const int flags[4] = {z, n, h, c};
+        uint32_t keep = 0x0F;
+        uint32_t set = 0;
+        for (int i = 0; i < 4; ++i) {
+            const uint32_t bit = 0x80 >> i;
+            if (flags[i] == kKeep) {
+                keep |= bit;
+            } else if (flags[i] == kSet) {
+                set |= bit;
+            }
+        }
+        _as.AluI(kAnd, kGuest[kF], keep);
+        if (set) {
+            _as.AluI(kOr, kGuest[kF], set);
+        }
+        for (int i = 0; i < 4; ++i) {
+            if (flags[i] >= 0) {
+                _as.Shl(flags[i], 7 - i);
+                _as.Alu(kOr, kGuest[kF], flags[i]);
+            }
+        }
+    }
+    // dst = (value == 0)
+    void IsZero(int dst, int value) {
+        _as.Test(value, value);
+        _as.Set(kEqual, dst);
+    }
+
+    // RCX = hi << 8 | lo
+    void Pair(int hi, int lo) {
+        _as.Mov(RCX, kGuest[hi]);
+        _as.Shl(RCX, 8);
+        _as.Alu(kOr, RCX, kGuest[lo]);
+    }
+    void IncPair(int hi, int lo, AluOp op) {
+        Pair(hi, lo);
+        _as.AluI(op, RCX, 1);
+        _as.Mov(kGuest[lo], RCX);
+        _as.AluI(kAnd, kGuest[lo], 0xFF);
+        _as.Shr(RCX, 8);
+        _as.AluI(kAnd, RCX, 0xFF);
+        _as.Mov(kGuest[hi], RCX);
+    }
+    // RBX = host address of the guest address in RCX, through a page table.
+    // Bails out if that page isn't plain memory. Clobbers RAX and RCX.
+    void Pointer(const void* pages) {
+        _as.Mov(RAX, RCX);
+        _as.Shr(RAX, 8);
+        _as.MovQI(RBX, pages);
+        _as.LoadQIndexed(RBX, RBX, RAX);
+        _as.TestQ(RBX);
+        BailIf(kEqual);
+        _as.AluI(kAnd, RCX, 0xFF);
+        _as.AddQ(RBX, RCX);
+    }
+    // Same for a constant address. HRAM isn't in the page tables, its
+    // accesses have no side effect besides invalidating code.
+    bool Pointer(uint16_t addr, bool write) {
+        if (addr >= 0xFF80 && addr < 0xFFFF) {
+            _as.MovQI(RBX, _mem.hram + (addr - 0xFF80));
+            if (write) {
+                _as.MovQI(RAX, _mem.hram_watched);
+                _as.Cmp8I(RAX, 0);
+                BailIf(kNotEqual);
+            }
+            return true;
+        }
+        if (addr >= 0xFF00) {
+            return false;
+        }
+        const void* pages = write ? static_cast<const void*>(_mem.write_pages)
+                                  : static_cast<const void*>(_mem.read_pages);
+        _as.MovQI(RBX, static_cast<const byte* const*>(pages) + (addr >> 8));
+        _as.LoadQ(RBX, RBX);
+        _as.TestQ(RBX);
+        BailIf(kEqual);
+        _as.AddQI(RBX, addr & 0xFF);
+        return true;
+    }
+    // RBX = host address of (HL). A writable page is readable too, at the
+    // same address.
+    void HLPointer(bool write) {
+        Pair(kH, kL);
+        Pointer(write ? static_cast<const void*>(_mem.write_pages)
+                      : static_cast<const void*>(_mem.read_pages));
+    }
+
+    // Register of operand r, in the opcodes' B, C, D, E, H, L, (HL), A order,
+    // loading (HL) in RCX.
+    int Operand(int r) {
+        if (r == 6) {
+            HLPointer(false);
+            _as.Load8(RCX, RBX);
+            return RCX;
+        }
+        return kGuest[r];
+    }
+
+    void Alu(int op, int src) {
+        const int a = kGuest[kA];
+        switch (op) {
+            case 0:  // add
+            case 1:  // adc
+            case 2:  // sub
+            case 3:  // sbc
+            case 7:  // cp
+            {
+                const bool sub = op >= 2;
+                const bool carry = op == 1 || op == 3;
+                if (carry) {
+                    _as.Mov(RDX, kGuest[kF]);
+                    _as.Shr(RDX, 4);
+                    _as.AluI(kAnd, RDX, 1);
+                }
+                _as.Mov(RAX, a);
+                _as.Alu(sub ? kSub : kAdd, RAX, src);
+                if (carry) {
+                    _as.Alu(sub ? kSub : kAdd, RAX, RDX);
+                }
+                // Half carry is bit 4 of a ^ src ^ result
+                _as.Mov(RDX, a);
+                _as.Alu(kXor, RDX, src);
+                _as.Alu(kXor, RDX, RAX);
+                _as.Shr(RDX, 4);
+                _as.AluI(kAnd, RDX, 1);
+                _as.Mov(RBX, RAX);
+                _as.Shr(RBX, 8);
+                _as.AluI(kAnd, RBX, 1);
+                _as.AluI(kAnd, RAX, 0xFF);
+                if (op != 7) {
+                    _as.Mov(a, RAX);
+                }
+                IsZero(RCX, RAX);
+                SetFlags(RCX, sub ? kSet : kClear, RDX, RBX);
+                break;
+            }
+            case 4:
+                _as.Alu(kAnd, a, src);
+                IsZero(RAX, a);
+                SetFlags(RAX, kClear, kSet, kClear);
+                break;
+            case 5:
+                _as.Alu(kXor, a, src);
+                IsZero(RAX, a);
+                SetFlags(RAX, kClear, kClear, kClear);
+                break;
+            case 6:
+                _as.Alu(kOr, a, src);
+                IsZero(RAX, a);
+                SetFlags(RAX, kClear, kClear, kClear);
+                break;
+        }
+    }
+
+    void IncDec(int reg, bool dec) {
+        _as.Mov(RDX, reg);
+        _as.AluI(kAnd, RDX, 0xF);
+        if (!dec) {
+            _as.AluI(kCmp, RDX, 0xF);
+        }
+        _as.Set(kEqual, RDX);
+        _as.AluI(dec ? kSub : kAdd, reg, 1);
+        _as.AluI(kAnd, reg, 0xFF);
+        IsZero(RAX, reg);
+        SetFlags(RAX, dec ? kSet : kClear, RDX, kKeep);
+    }
+
+    // Returns the cycles taken, or 0 if op can't be translated
+    int Instruction(const BlockCache::Op& op) {
+        const byte code = op.opcode;
+        const int x = code >> 3 & 7;
+        const int y = code & 7;
+        if (code >= 0x40 && code < 0x80 && code != 0x76) {
+            if (x == 6) {
+                HLPointer(true);
+                _as.Store8(RBX, kGuest[y]);
+                return 8;
+            }
+            _as.Mov(kGuest[x], Operand(y));
+            return y == 6 ? 8 : 4;
+        }
+        if (code >= 0x80 && code < 0xC0) {
+            Alu(x, Operand(y));
+            return y == 6 ? 8 : 4;
+        }
+        if ((code & 0xC7) == 0xC6) {
+            _as.MovI(RCX, op.imm.bytes.l.u);
+            Alu(x, RCX);
+            return 8;
+        }
+        if ((code & 0xC6) == 0x04) {  // inc, dec
+            if (x == 6) {
+                HLPointer(true);
+                _as.Load8(RCX, RBX);
+                IncDec(RCX, code & 1);
+                _as.Store8(RBX, RCX);
+                return 12;
+            }
+            IncDec(kGuest[x], code & 1);
+            return 4;
+        }
+        if ((code & 0xC7) == 0x06) {  // ld r, n
+            if (x == 6) {
+                HLPointer(true);
+                _as.MovI(RCX, op.imm.bytes.l.u);
+                _as.Store8(RBX, RCX);
+                return 12;
+            }
+            _as.MovI(kGuest[x], op.imm.bytes.l.u);
+            return 8;
+        }
+
+        switch (code) {
+            case 0x00:
+                return 4;
+            case 0x01:
+            case 0x11:
+            case 0x21:
+                _as.MovI(kGuest[x], op.imm.bytes.h.u);
+                _as.MovI(kGuest[x + 1], op.imm.bytes.l.u);
+                return 12;
+            case 0x03:
+            case 0x13:
+            case 0x23:
+                IncPair(x, x + 1, kAdd);
+                return 8;
+            case 0x0B:
+            case 0x1B:
+            case 0x2B:
+                IncPair(x - 1, x, kSub);
+                return 8;
+            case 0x02:
+            case 0x12:
+                Pair(x, x + 1);
+                Pointer(_mem.write_pages);
+                _as.Store8(RBX, kGuest[kA]);
+                return 8;
+            case 0x0A:
+            case 0x1A:
+                Pair(x - 1, x);
+                Pointer(_mem.read_pages);
+                _as.Load8(kGuest[kA], RBX);
+                return 8;
+            case 0x22:  // ldi (hl), a
+            case 0x32:  // ldd (hl), a
+                HLPointer(true);
+                _as.Store8(RBX, kGuest[kA]);
+                IncPair(kH, kL, code == 0x22 ? kAdd : kSub);
+                return 8;
+            case 0x2A:  // ldi a, (hl)
+            case 0x3A:  // ldd a, (hl)
+                HLPointer(false);
+                _as.Load8(kGuest[kA], RBX);
+                IncPair(kH, kL, code == 0x2A ? kAdd : kSub);
+                return 8;
+            case 0x2F:  // cpl
+                _as.AluI(kXor, kGuest[kA], 0xFF);
+                SetFlags(kKeep, kSet, kSet, kKeep);
+                return 4;
+            case 0x37:  // scf
+                SetFlags(kKeep, kClear, kClear, kSet);
+                return 4;
+            case 0x3F:  // ccf
+                _as.AluI(kXor, kGuest[kF], 0x10);
+                SetFlags(kKeep, kClear, kClear, kKeep);
+                return 4;
+            case 0xE0:
+            case 0xF0:
+            case 0xEA:
+            case 0xFA: {
+                const uint16_t addr = code & 0x08 ? op.imm.u
+                                                  : 0xFF00 + op.imm.bytes.l.u;
+                const bool write = !(code & 0x10);
+                if (!Pointer(addr, write)) {
+                    return 0;
+                }
+                if (write) {
+                    _as.Store8(RBX, kGuest[kA]);
+                } else {
+                    _as.Load8(kGuest[kA], RBX);
+                }
+                return code & 0x08 ? 16 : 12;
+            }
+            case 0xCB:
+                return Extended(op.imm.bytes.l.u);
+        }
+        return 0;
+    }
+
+    // Only swap, bit, res and set, the shifts aren't common enough
+    int Extended(byte code) {
+        const int bit = code >> 3 & 7;
+        const int r = code & 7;
+        if (code < 0x30 || (code >= 0x38 && code < 0x40)) {
+            return 0;
+        }
+        if (code < 0x38) {  // swap
+            if (r == 6) {
+                return 0;
+            }
+            const int reg = kGuest[r];
+            _as.Mov(RAX, reg);
+            _as.Shr(RAX, 4);
+            _as.Shl(reg, 4);
+            _as.Alu(kOr, reg, RAX);
+            _as.AluI(kAnd, reg, 0xFF);
+            IsZero(RAX, reg);
+            SetFlags(RAX, kClear, kClear, kClear);
+            return 8;
+        }
+        if (code < 0x80) {  // bit
+            _as.TestI(Operand(r), 1 << bit);
+            _as.Set(kEqual, RAX);
+            SetFlags(RAX, kClear, kSet, kKeep);
+            return r == 6 ? 12 : 8;
+        }
+        int reg = kGuest[r];
+        if (r == 6) {
+            HLPointer(true);
+            _as.Load8(RCX, RBX);
+            reg = RCX;
+        }
+        if (code < 0xC0) {
+            _as.AluI(kAnd, reg, ~(1u << bit) & 0xFF);
+        } else {
+            _as.AluI(kOr, reg, 1 << bit);
+        }
+        if (r == 6) {
+            _as.Store8(RBX, RCX);
+            return 16;
+        }
+        return 8;
+    }
+
+    // Ends the translation on jr and jp, returning the cycles of the longest
+    // path. Anything else ending a block isn't translated.
+    int Branch(const BlockCache::Op& op) {
+        const byte code = op.opcode;
+        const uint16_t next = op.pc + Z80::length(code);
+        uint16_t target;
+        int taken, not_taken;
+        if (code == 0x18 || (code & 0xE7) == 0x20) {
+            target = next + op.imm.bytes.l.s;
+            taken = 12;
+            not_taken = 8;
+        } else if (code == 0xC3 || (code & 0xE7) == 0xC2) {
+            target = op.imm.u;
+            taken = 16;
+            not_taken = 12;
+        } else if (code == 0xE9) {
+            Pair(kH, kL);
+            _as.StoreExitReg(0, RCX);
+            _as.StoreExit(4, _n + 1);
+            _as.MovI(RAX, _cycles + 4);
+            return 4;
+        } else {
+            return 0;
+        }
+
+        _as.StoreExit(4, _n + 1);
+        if (code == 0x18 || code == 0xC3) {
+            _as.StoreExit(0, target);
+            _as.MovI(RAX, _cycles + taken);
+            return taken;
+        }
+        // nz, z, nc, c
+        const int cc = code >> 3 & 3;
+        _as.TestI(kGuest[kF], cc & 2 ? 0x10 : 0x80);
+        const size_t skip = _as.Jump(cc & 1 ? kEqual : kNotEqual);
+        _as.StoreExit(0, target);
+        _as.MovI(RAX, _cycles + taken);
+        _to_epilogue.push_back(_as.Jump());
+        _as.Bind(skip);
+        _as.StoreExit(0, next);
+        _as.MovI(RAX, _cycles + not_taken);
+        return taken;
+    }
+
+    const Memory _mem;
+    Assembler _as;
+    uint16_t _pc;
+    // Instructions and cycles before the current instruction
+    int _n;
+    int _cycles;
+    std::vector<size_t> _bails;
+    std::vector<Stub> _stubs;
+    std::vector<size_t> _to_epilogue;
+};
+
+}  // namespace
+
+Jit::Jit(AddressBus& addr)
+    : _addr(addr), _used(0), _full(false), _disabled(false) {
+    void* code = mmap(nullptr, kCodeSize, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        throw std::runtime_error("Can't map the JIT code buffer");
+    }
+    _code = static_cast<byte*>(code);
+}
+
+Jit::~Jit() { munmap(_code, kCodeSize); }
+
+bool Jit::supported() { return true; }
+
+bool Jit::Translate(BlockCache::Block& block) {
+    if (_disabled) {
+        return false;
+    }
+    int span;
+    std::vector<byte> native =
+        Translator(_addr.plain_memory()).Translate(block, &span);
+    if (native.empty()) {
+        return false;
+    }
+    if (_used + native.size() > kCodeSize) {
+        _full = true;
+        return false;
+    }
+
+    // Only the pages being written are ever writable
+    const size_t page = sysconf(_SC_PAGESIZE);
+    byte* begin = _code + (_used & ~(page - 1));
+    byte* end = _code + _used + native.size();
+    if (mprotect(begin, end - begin, PROT_READ | PROT_WRITE) != 0) {
+        return Disable();
+    }
+    std::memcpy(_code + _used, native.data(), native.size());
+    if (mprotect(begin, end - begin, PROT_READ | PROT_EXEC) != 0) {
+        return Disable();
+    }
+
+    block.native = reinterpret_cast<BlockCache::NativeCode>(_code + _used);
+    block.native_span = span;
+    _used += (native.size() + 15) & ~size_t(15);
+    return true;
+}
+
+void Jit::Flush() {
+    _used = 0;
+    _full = false;
+}
+
+// Translations sharing the page may not be executable anymore: reporting the
+// buffer full has them all dropped, and the interpreter runs everything.
+bool Jit::Disable() {
+    cerror << "Can't change the JIT code buffer protection, JIT disabled\n";
+    _disabled = true;
+    _full = true;
+    return false;
+}
+
+#else
+
+Jit::Jit(AddressBus& addr)
+    : _addr(addr), _code(nullptr), _used(0), _full(false), _disabled(true) {}
+
+Jit::~Jit() {}
+
+bool Jit::supported() { return false; }
+
+bool Jit::Translate(BlockCache::Block&) { return false; }
+
+void Jit::Flush() {}
+
+#endif
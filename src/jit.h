@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+
+#include "blockcache.h"
+
+class AddressBus;
+
+// Translates hot blocks to x86-64, with the guest registers held in host
+// registers. Native code only touches plain memory, through the bus' page
+// tables: before any other access, and before the first instruction it can't
+// translate, it stops and leaves the rest to the interpreter. It doesn't look
+// at the scheduler either, so it may only be entered when no deadline falls
+// before its last instruction starts, see Block::native_span.
+class Jit {
+   public:
+    explicit Jit(AddressBus& addr);
+    ~Jit();
+
+    // False on hosts without a backend, where Translate always fails
+    static bool supported();
+
+    // Sets block.native and block.native_span. Fails if the first instruction
+    // can't be translated, if the code buffer is full or if the host refuses
+    // to make it executable.
+    bool Translate(BlockCache::Block& block);
+    bool full() const { return _full; }
+    // Empties the code buffer, leaving all translations dangling
+    void Flush();
+
+   private:
+    // Gives up on native code when the buffer can't be made executable
+    bool Disable();
+
+    AddressBus& _addr;
+    byte* _code;
+    size_t _used;
+    bool _full;
+    bool _disabled;
+};
@@ -2,13 +2,20 @@
 
 #include <cassert>
 
-#include <sdl.h>
+#include "frontend/frontend.h"
+#include "state.h"
 
 class Keypad {
    public:
     using byte = unsigned char;
 
-    Keypad() : _keys(0) {}
+    Keypad(Input& input)
+        : _input(input),
+          _pressed(false),
+          _dir_keys(false),
+          _buttons_keys(false),
+          _keys(0),
+          _quit(false) {}
 
     void set_joyp(byte v) {
         _dir_keys = ((v >> 4) & 1) == 0;
@@ -24,46 +31,41 @@ class Keypad {
         }
     }
 
-    bool poweroff() const { return _keys & 0x200; }
-    bool max_speed() const { return _keys & 0x100; }
+    bool poweroff() const { return _quit; }
     bool pressed() const { return _pressed; }
 
+    // Reads the input when the game doesn't, returns whether a key got
+    // pressed.
+    bool Poll() {
+        RefreshKeys();
+        return _pressed;
+    }
+
+    void SaveState(StateWriter& w) const {
+        w.Write(_pressed);
+        w.Write(_dir_keys);
+        w.Write(_buttons_keys);
+        w.Write(_keys);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_pressed);
+        r.Read(_dir_keys);
+        r.Read(_buttons_keys);
+        r.Read(_keys);
+    }
+
    private:
     void RefreshKeys() {
-        SDL_Event event;
-        _pressed = false;
         int prev_key = _keys;
-        while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                _keys |= 0x200;
-            }
-            if (event.type == SDL_KEYDOWN) {
-                _keys |= ((event.key.keysym.sym == SDLK_LCTRL) << 8) |
-                         ((event.key.keysym.sym == SDLK_DOWN) << 7) |
-                         ((event.key.keysym.sym == SDLK_UP) << 6) |
-                         ((event.key.keysym.sym == SDLK_LEFT) << 5) |
-                         ((event.key.keysym.sym == SDLK_RIGHT) << 4) |
-                         ((event.key.keysym.sym == SDLK_RETURN) << 3) |
-                         ((event.key.keysym.sym == SDLK_BACKSPACE) << 2) |
-                         ((event.key.keysym.sym == SDLK_d) << 1) |
-                         ((event.key.keysym.sym == SDLK_s) << 0);
-            } else if (event.type == SDL_KEYUP) {
-                _keys &= ~(((event.key.keysym.sym == SDLK_LCTRL) << 8) |
-                           ((event.key.keysym.sym == SDLK_DOWN) << 7) |
-                           ((event.key.keysym.sym == SDLK_UP) << 6) |
-                           ((event.key.keysym.sym == SDLK_LEFT) << 5) |
-                           ((event.key.keysym.sym == SDLK_RIGHT) << 4) |
-                           ((event.key.keysym.sym == SDLK_RETURN) << 3) |
-                           ((event.key.keysym.sym == SDLK_BACKSPACE) << 2) |
-                           ((event.key.keysym.sym == SDLK_d) << 1) |
-                           ((event.key.keysym.sym == SDLK_s) << 0));
-            }
-        }
+        _keys = _input.Poll();
+        _quit = _input.quit();
         _pressed = (_keys | prev_key) != prev_key;
     }
 
+    Input& _input;
     bool _pressed;
     bool _dir_keys;
     bool _buttons_keys;
     int _keys;
+    bool _quit;
 };
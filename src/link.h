@@ -1,13 +1,15 @@
 #pragma once
 
 #include <cassert>
+#include "scheduler.h"
+#include "state.h"
 #include "utils.h"
 
 class LinkCable {
    public:
     using byte = unsigned char;
 
-    void Clock() { _transferred = false; }
+    LinkCable(Scheduler& sched) : _serial_control(0), _data(0), _sched(sched) {}
 
     byte Read() {
         // TODO: implement
@@ -16,20 +18,36 @@ class LinkCable {
 
     void Send(byte b) { _data = b; }
 
-    bool transferred() const { return _transferred; }
+    // Completes the transfer in progress, the serial interrupt is due.
+    void Step() {
+        _serial_control = 1;
+        _sched.Cancel(Scheduler::SERIAL);
+    }
 
     byte serial_control() const { return _serial_control; }
     void set_serial_control(byte v) {
         if (v == 0x81) {
-            _serial_control = 1;
-            _transferred = true;
+            _serial_control = v;
             serial << _data;
             std::cout.flush();
+            _sched.Schedule(Scheduler::SERIAL, _sched.now() + kTransferCycles);
         }
     }
 
+    void SaveState(StateWriter& w) const {
+        w.Write(_serial_control);
+        w.Write(_data);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_serial_control);
+        r.Read(_data);
+    }
+
    private:
+    // 8 bits shifted at 8192Hz with the internal clock
+    static const int kTransferCycles = 8 * kCpuFreq / 8192;
+
     byte _serial_control;
-    byte _transferred;
     byte _data;
+    Scheduler& _sched;
 };
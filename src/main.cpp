@@ -8,36 +8,14 @@
 ** Last update 2014-02-19 18:35 vermeille
 */
 
-#include <signal.h>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
 
-#include "addressbus.h"
-#include "apu/sound.h"
-#include "cartridge.h"
-#include "gpu/video.h"
-#include "keypad.h"
-#include "link.h"
-#include "timer.h"
-#include "z80.h"
-
-static Z80* z80_ptr;
-
-Logger cinstr;
-Logger cdebug;
-Logger cevent;
-Logger cerror;
-Logger serial;
-
-void segv_handler(int) {
-    z80_ptr->Dump();
-    exit(1);
-}
-
-void sigint_handler(int) {
-    std::cout << "END\n";
-    z80_ptr->poweroff();
-}
+#include "frontend/cli.h"
+#include "frontend/null.h"
+#include "frontend/sdlfrontend.h"
+#include "gameboy.h"
 
 int main(int argc, char** argv) {
     if (argc <= 1) {
@@ -45,49 +23,28 @@ int main(int argc, char** argv) {
     }
 
     bool mute = false;
-    std::string gamefile;
+    CommonOptions opts;
     for (int i = 1; i < argc; ++i) {
-        if (argv[i][0] != '-') {
-            gamefile = argv[i];
-        } else if (argv[i] == std::string("--show-instr")) {
-            cinstr.enabled = true;
-        } else if (argv[i] == std::string("--show-debug")) {
-            cdebug.enabled = true;
-        } else if (argv[i] == std::string("--show-event")) {
-            cevent.enabled = true;
-        } else if (argv[i] == std::string("--serial")) {
-            serial.enabled = true;
-        } else if (argv[i] == std::string("--errors")) {
-            cerror.enabled = true;
+        if (ParseCommonOption(argc, argv, i, opts)) {
+            continue;
         } else if (argv[i] == std::string("--mute")) {
             mute = true;
-        } else if (argv[i][0] == '-') {
+        } else {
             std::cerr << "unknown option " << argv[i] << "\n";
             return 1;
-        } else if (!gamefile.empty()) {
-            std::cerr << "unrecognized option " << argv[i] << "\n";
-            return 1;
         }
     }
-    InitVideo();
-    InitAudio();
-
-    Video v;
-    Sound s(mute);
-    Cartridge card(gamefile);
-    LinkCable lk;
-    Keypad kp;
-    Timer timer;
-    AddressBus addrbus(card, v, lk, kp, timer, s);
-    Z80 processor(addrbus, v, lk, timer, s, kp);
-    z80_ptr = &processor;
-    struct sigaction action;
-    action.sa_handler = segv_handler;
-    sigaction(SIGSEGV, &action, nullptr);
+    SdlFrontend frontend;
+    std::unique_ptr<AudioOutput> audio;
+    if (mute) {
+        audio = std::make_unique<NullAudio>();
+    } else {
+        audio = std::make_unique<SdlAudio>();
+    }
 
-    struct sigaction int_action;
-    int_action.sa_handler = sigint_handler;
-    sigaction(SIGINT, &int_action, nullptr);
-    processor.Process();
+    Gameboy gb(opts.gamefile, frontend, *audio, frontend);
+    ApplyCommonOptions(gb, opts);
+    InstallSignalHandlers(gb);
+    gb.Run();
     return 0;
 }
@@ -0,0 +1,243 @@
+// Measures how fast a game is emulated, for tracking performance across
+// commits. Runs headless, and prints one JSON object or CSV record.
+
+#include <signal.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "frontend/null.h"
+#include "gameboy.h"
+#include "profiler.h"
+
+static const int kSamplePeriodNs = 20000;
+
+struct Result {
+    uint64_t cycles;
+    uint64_t instructions;
+    int frames_rendered;
+    uint64_t checksum;
+    double wall_s;
+};
+
+static Result Run(const std::string& gamefile,
+                  uint64_t cycles,
+                  bool jit,
+                  const std::string& aot) {
+    MemoryDisplay display;
+    NullAudio audio;
+    NullInput input;
+    Gameboy gb(gamefile, display, audio, input);
+    gb.cpu().set_jit(jit);
+    if (!aot.empty()) {
+        gb.cpu().LoadAot(aot);
+    }
+
+    profiler.Reset();
+    auto start = std::chrono::steady_clock::now();
+    uint64_t now = gb.scheduler().now();
+    const uint64_t end = now + cycles;
+    while (now < end) {
+        gb.RunCycles(std::min<uint64_t>(Gameboy::kCyclesPerFrame, end - now));
+        uint64_t prev = now;
+        now = gb.scheduler().now();
+        if (now == prev) {
+            break;  // powered off
+        }
+    }
+    std::chrono::duration<double> wall =
+        std::chrono::steady_clock::now() - start;
+
+    return {gb.scheduler().now(), gb.cpu().instructions(), display.frames(),
+            display.checksum(), wall.count()};
+}
+
+void sigprof_handler(int) { profiler.Sample(); }
+
+// Samples the current zone every kSamplePeriodNs of wall time. Interval
+// timers only tick at the scheduler's resolution, POSIX timers are precise.
+static timer_t StartSampling() {
+    struct sigaction action = {};
+    action.sa_handler = sigprof_handler;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &action, nullptr);
+
+    struct sigevent event = {};
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = SIGPROF;
+    timer_t timer;
+    if (timer_create(CLOCK_MONOTONIC, &event, &timer) != 0) {
+        throw std::runtime_error("Can't create the sampling timer");
+    }
+
+    struct itimerspec period = {};
+    period.it_interval.tv_nsec = kSamplePeriodNs;
+    period.it_value.tv_nsec = kSamplePeriodNs;
+    timer_settime(timer, 0, &period, nullptr);
+    return timer;
+}
+
+static void StopSampling(timer_t timer) { timer_delete(timer); }
+
+// s as a JSON string, quotes included
+static std::string JsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// s as a CSV field, quoted only if it has to be
+static std::string CsvField(const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) {
+        return s;
+    }
+    std::string out = "\"";
+    for (char c : s) {
+        out += c;
+        if (c == '"') {
+            out += '"';
+        }
+    }
+    return out + "\"";
+}
+
+static void Usage() {
+    std::cerr << "usage: gamulator-bench [--frames N | --cycles N] "
+                 "[--format json|csv] [--no-breakdown] [--jit] [--aot game.so] "
+                 "game.gb\n";
+}
+
+int main(int argc, char** argv) {
+    uint64_t cycles = 600 * uint64_t(Gameboy::kCyclesPerFrame);
+    std::string format = "json";
+    bool breakdown = true;
+    bool jit = false;
+    std::string aot;
+    std::string gamefile;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] != '-') {
+            gamefile = argv[i];
+        } else if (argv[i] == std::string("--frames") && i + 1 < argc) {
+            cycles = std::strtoull(argv[++i], nullptr, 10) *
+                     Gameboy::kCyclesPerFrame;
+        } else if (argv[i] == std::string("--cycles") && i + 1 < argc) {
+            cycles = std::strtoull(argv[++i], nullptr, 10);
+        } else if (argv[i] == std::string("--format") && i + 1 < argc) {
+            format = argv[++i];
+        } else if (argv[i] == std::string("--no-breakdown")) {
+            breakdown = false;
+        } else if (argv[i] == std::string("--jit")) {
+            jit = true;
+        } else if (argv[i] == std::string("--aot") && i + 1 < argc) {
+            aot = argv[++i];
+        } else {
+            std::cerr << "unknown option " << argv[i] << "\n";
+            Usage();
+            return EXIT_FAILURE;
+        }
+    }
+    if (gamefile.empty() || (format != "json" && format != "csv")) {
+        Usage();
+        return EXIT_FAILURE;
+    }
+
+    // The emulator chats on stdout, keep it for the results only
+    auto stdout_buf = std::cout.rdbuf(nullptr);
+
+    // The headline numbers come from a run without any timing overhead, the
+    // breakdown from a second identical run.
+    Result r = Run(gamefile, cycles, jit, aot);
+    if (breakdown) {
+        profiler.enabled = true;
+        timer_t timer = StartSampling();
+        Run(gamefile, cycles, jit, aot);
+        StopSampling(timer);
+        profiler.enabled = false;
+    }
+
+    std::cout.rdbuf(stdout_buf);
+    std::cout.clear();
+    std::cout << std::dec;
+
+    const double frames = double(r.cycles) / Gameboy::kCyclesPerFrame;
+    const double mhz = r.cycles / r.wall_s / 1e6;
+    const double fps = frames / r.wall_s;
+    const double speed = double(r.cycles) / kCpuFreq / r.wall_s;
+    const double us_per_frame = r.wall_s * 1e6 / frames;
+
+    uint64_t total_samples = 0;
+    for (int z = 0; z < Profiler::kNbZones; ++z) {
+        total_samples += profiler.samples(Profiler::Zone(z));
+    }
+    auto share = [&](int z) {
+        return total_samples
+                   ? double(profiler.samples(Profiler::Zone(z))) / total_samples
+                   : 0.;
+    };
+
+    std::cout.precision(6);
+    if (format == "json") {
+        std::cout << "{\"game\": " << JsonString(gamefile) << ", "
+                  << "\"cycles\": " << r.cycles << ", "
+                  << "\"frames\": " << frames << ", "
+                  << "\"frames_rendered\": " << r.frames_rendered << ", "
+                  << "\"instructions\": " << r.instructions << ", "
+                  << "\"wall_s\": " << r.wall_s << ", "
+                  << "\"emulated_mhz\": " << mhz << ", "
+                  << "\"fps\": " << fps << ", "
+                  << "\"speed\": " << speed << ", "
+                  << "\"us_per_frame\": " << us_per_frame << ", "
+                  << "\"checksum\": \"" << std::hex << r.checksum << std::dec
+                  << "\"";
+        if (breakdown) {
+            std::cout << ", \"samples\": " << total_samples
+                      << ", \"breakdown\": {";
+            for (int z = 0; z < Profiler::kNbZones; ++z) {
+                auto zone = Profiler::Zone(z);
+                std::cout << (z ? ", " : "") << "\"" << Profiler::name(zone)
+                          << "\": {\"share\": " << share(z)
+                          << ", \"calls\": " << profiler.calls(zone) << "}";
+            }
+            std::cout << "}";
+        }
+        std::cout << "}\n";
+    } else {
+        std::cout << "game,cycles,frames,frames_rendered,instructions,wall_s,"
+                     "emulated_mhz,fps,speed,us_per_frame,checksum";
+        if (breakdown) {
+            for (int z = 0; z < Profiler::kNbZones; ++z) {
+                std::cout << "," << Profiler::name(Profiler::Zone(z))
+                          << "_share";
+            }
+        }
+        std::cout << "\n"
+                  << CsvField(gamefile) << "," << r.cycles << "," << frames << ","
+                  << r.frames_rendered << "," << r.instructions << ","
+                  << r.wall_s << "," << mhz << "," << fps << "," << speed
+                  << "," << us_per_frame << "," << std::hex << r.checksum
+                  << std::dec;
+        if (breakdown) {
+            for (int z = 0; z < Profiler::kNbZones; ++z) {
+                std::cout << "," << share(z);
+            }
+        }
+        std::cout << "\n";
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+// Runs a game without display, audio nor input, for batch and CI hosts.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "frontend/cli.h"
+#include "frontend/null.h"
+#include "gameboy.h"
+
+// Powers the machine off once enough frames have been rendered.
+class FrameLimit : public MemoryDisplay {
+   public:
+    FrameLimit(int limit) : _limit(limit), _gb(nullptr) {}
+
+    void set_gameboy(Gameboy* gb) { _gb = gb; }
+
+    void Present(const Color* pixels) override {
+        MemoryDisplay::Present(pixels);
+        if (frames() == _limit) {
+            _gb->poweroff();
+        }
+    }
+
+   private:
+    int _limit;
+    Gameboy* _gb;
+};
+
+// Runs the game twice in lockstep, with and without the JIT, and compares
+// the whole machines every step cycles. Returns the exit status.
+static int VerifyJit(CommonOptions opts, int frames, uint64_t step) {
+    MemoryDisplay jit_display, ref_display;
+    NullAudio audio;
+    NullInput input;
+    opts.jit = true;
+    Gameboy jit(opts.gamefile, jit_display, audio, input);
+    ApplyCommonOptions(jit, opts);
+    opts.jit = false;
+    Gameboy ref(opts.gamefile, ref_display, audio, input);
+    ApplyCommonOptions(ref, opts);
+
+    const uint64_t end = uint64_t(frames < 0 ? 600 : frames) *
+                         Gameboy::kCyclesPerFrame;
+    std::vector<byte> jit_state, ref_state;
+    while (ref.scheduler().now() < end) {
+        jit.RunCycles(step);
+        ref.RunCycles(step);
+        jit.SaveState(jit_state);
+        ref.SaveState(ref_state);
+        if (jit_state != ref_state) {
+            std::cout << "jit-verify: states differ at cycle " << std::dec
+                      << ref.scheduler().now() << "\n";
+            return 1;
+        }
+    }
+    std::cout << "jit-verify: " << std::dec << ref.scheduler().now()
+              << " cycles match\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc <= 1) {
+        return EXIT_FAILURE;
+    }
+
+    int frames = -1;
+    CommonOptions opts;
+    std::string coverage;
+    uint64_t verify_step = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (ParseCommonOption(argc, argv, i, opts)) {
+            continue;
+        } else if (argv[i] == std::string("--frames") && i + 1 < argc) {
+            frames = std::atoi(argv[++i]);
+        } else if (argv[i] == std::string("--coverage") && i + 1 < argc) {
+            coverage = argv[++i];
+        } else if (argv[i] == std::string("--jit-verify") && i + 1 < argc) {
+            verify_step = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    if (verify_step) {
+        return VerifyJit(opts, frames, verify_step);
+    }
+
+    FrameLimit display(frames);
+    NullAudio audio;
+    NullInput input;
+    Gameboy gb(opts.gamefile, display, audio, input);
+    ApplyCommonOptions(gb, opts);
+    display.set_gameboy(&gb);
+    InstallSignalHandlers(gb);
+    gb.Run();
+
+    std::cout << "frames: " << std::dec << display.frames()
+              << " checksum: " << std::hex << display.checksum()
+              << "\n";
+    if (!coverage.empty()) {
+        std::ofstream out(coverage);
+        gb.cpu().WriteCoverage(out);
+    }
+    return 0;
+}
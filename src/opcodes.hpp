@@ -0,0 +1,1035 @@
+#pragma once
+
+#include <stdexcept>
+
+#include "z80.h"
+
+#include "instruction.hpp"
+
+// Opcode table: maps every opcode to the Action<Op1, Op2> implementing it.
+// Being plain types, the table can be expanded into the dispatch switch of
+// Z80::RunOpcode and each handler inlined there. Tr, the tracing policy, is
+// handed down to the operands and actions which trace what they do.
+
+template <byte Op, class Tr>
+struct Z80::Opcode {
+    static int Do(Z80*) {
+        throw std::runtime_error("Invalid opcode " + hex(int(Op)));
+    }
+    static void Print(Z80*) { cinstr << "invalid opcode\n"; }
+};
+
+template <class Tr>
+struct Z80::Opcode<0x00, Tr> : NOP<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x01, Tr> : LDw<Register<BC>, NextWord> {};
+template <class Tr>
+struct Z80::Opcode<0x02, Tr> : LD<ToAddr<Register<BC>, Tr>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x03, Tr> : INCw<Register<BC>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x04, Tr> : INC<Register<B>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x05, Tr> : DEC<Register<B>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x06, Tr> : LD<Register<B>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0x07, Tr> : RLCA<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x08, Tr> : LDw<ToAddr<NextWord, Tr>, Register<SP>> {};
+template <class Tr>
+struct Z80::Opcode<0x09, Tr> : ADDw<Register<HL>, Register<BC>> {};
+template <class Tr>
+struct Z80::Opcode<0x0A, Tr> : LD<Register<A>, ToAddr<Register<BC>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x0B, Tr> : DECw<Register<BC>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x0C, Tr> : INC<Register<C>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x0D, Tr> : DEC<Register<C>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x0E, Tr> : LD<Register<C>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0x0F, Tr> : RRCA<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x10, Tr> : STOP<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x11, Tr> : LDw<Register<DE>, NextWord> {};
+template <class Tr>
+struct Z80::Opcode<0x12, Tr> : LD<ToAddr<Register<DE>, Tr>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x13, Tr> : INCw<Register<DE>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x14, Tr> : INC<Register<D>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x15, Tr> : DEC<Register<D>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x16, Tr> : LD<Register<D>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0x17, Tr> : RLA<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x18, Tr> : JR<NextByte, void> {};
+template <class Tr>
+struct Z80::Opcode<0x19, Tr> : ADDw<Register<HL>, Register<DE>> {};
+template <class Tr>
+struct Z80::Opcode<0x1A, Tr> : LD<Register<A>, ToAddr<Register<DE>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x1B, Tr> : DECw<Register<DE>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x1C, Tr> : INC<Register<E>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x1D, Tr> : DEC<Register<E>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x1E, Tr> : LD<Register<E>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0x1F, Tr> : RRA<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x20, Tr> : JRNZ<NextByte, void> {};
+template <class Tr>
+struct Z80::Opcode<0x21, Tr> : LDw<Register<HL>, NextWord> {};
+template <class Tr>
+struct Z80::Opcode<0x22, Tr> : LDI<ToAddr<Register<HL>, Tr>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x23, Tr> : INCw<Register<HL>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x24, Tr> : INC<Register<H>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x25, Tr> : DEC<Register<H>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x26, Tr> : LD<Register<H>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0x27, Tr> : DAA<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x28, Tr> : JRZ<NextByte, void> {};
+template <class Tr>
+struct Z80::Opcode<0x29, Tr> : ADDw<Register<HL>, Register<HL>> {};
+template <class Tr>
+struct Z80::Opcode<0x2A, Tr> : LDI<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x2B, Tr> : DECw<Register<HL>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x2C, Tr> : INC<Register<L>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x2D, Tr> : DEC<Register<L>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x2E, Tr> : LD<Register<L>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0x2F, Tr> : CPL<Register<A>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x30, Tr> : JRNC<NextByte, void> {};
+template <class Tr>
+struct Z80::Opcode<0x31, Tr> : LDw<Register<SP>, NextWord> {};
+template <class Tr>
+struct Z80::Opcode<0x32, Tr> : LDD<ToAddr<Register<HL>, Tr>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x33, Tr> : INCw<Register<SP>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x34, Tr> : INC<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x35, Tr> : DEC<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x36, Tr> : LD<ToAddr<Register<HL>, Tr>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0x37, Tr> : SCF<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x38, Tr> : JRC<NextByte, void> {};
+template <class Tr>
+struct Z80::Opcode<0x39, Tr> : ADDw<Register<HL>, Register<SP>> {};
+template <class Tr>
+struct Z80::Opcode<0x3A, Tr> : LDD<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x3B, Tr> : DECw<Register<SP>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x3C, Tr> : INC<Register<A>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x3D, Tr> : DEC<Register<A>, void> {};
+template <class Tr>
+struct Z80::Opcode<0x3E, Tr> : LD<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0x3F, Tr> : CCF<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x40, Tr> : LD<Register<B>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x41, Tr> : LD<Register<B>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x42, Tr> : LD<Register<B>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x43, Tr> : LD<Register<B>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x44, Tr> : LD<Register<B>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x45, Tr> : LD<Register<B>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x46, Tr> : LD<Register<B>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x47, Tr> : LD<Register<B>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x48, Tr> : LD<Register<C>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x49, Tr> : LD<Register<C>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x4A, Tr> : LD<Register<C>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x4B, Tr> : LD<Register<C>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x4C, Tr> : LD<Register<C>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x4D, Tr> : LD<Register<C>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x4E, Tr> : LD<Register<C>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x4F, Tr> : LD<Register<C>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x50, Tr> : LD<Register<D>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x51, Tr> : LD<Register<D>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x52, Tr> : LD<Register<D>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x53, Tr> : LD<Register<D>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x54, Tr> : LD<Register<D>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x55, Tr> : LD<Register<D>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x56, Tr> : LD<Register<D>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x57, Tr> : LD<Register<D>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x58, Tr> : LD<Register<E>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x59, Tr> : LD<Register<E>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x5A, Tr> : LD<Register<E>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x5B, Tr> : LD<Register<E>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x5C, Tr> : LD<Register<E>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x5D, Tr> : LD<Register<E>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x5E, Tr> : LD<Register<E>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x5F, Tr> : LD<Register<E>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x60, Tr> : LD<Register<H>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x61, Tr> : LD<Register<H>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x62, Tr> : LD<Register<H>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x63, Tr> : LD<Register<H>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x64, Tr> : LD<Register<H>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x65, Tr> : LD<Register<H>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x66, Tr> : LD<Register<H>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x67, Tr> : LD<Register<H>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x68, Tr> : LD<Register<L>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x69, Tr> : LD<Register<L>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x6A, Tr> : LD<Register<L>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x6B, Tr> : LD<Register<L>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x6C, Tr> : LD<Register<L>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x6D, Tr> : LD<Register<L>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x6E, Tr> : LD<Register<L>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x6F, Tr> : LD<Register<L>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x70, Tr> : LD<ToAddr<Register<HL>, Tr>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x71, Tr> : LD<ToAddr<Register<HL>, Tr>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x72, Tr> : LD<ToAddr<Register<HL>, Tr>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x73, Tr> : LD<ToAddr<Register<HL>, Tr>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x74, Tr> : LD<ToAddr<Register<HL>, Tr>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x75, Tr> : LD<ToAddr<Register<HL>, Tr>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x76, Tr> : HALT<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0x77, Tr> : LD<ToAddr<Register<HL>, Tr>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x78, Tr> : LD<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x79, Tr> : LD<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x7A, Tr> : LD<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x7B, Tr> : LD<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x7C, Tr> : LD<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x7D, Tr> : LD<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x7E, Tr> : LD<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x7F, Tr> : LD<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x80, Tr> : ADD<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x81, Tr> : ADD<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x82, Tr> : ADD<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x83, Tr> : ADD<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x84, Tr> : ADD<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x85, Tr> : ADD<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x86, Tr> : ADD<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x87, Tr> : ADD<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x88, Tr> : ADC<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x89, Tr> : ADC<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x8A, Tr> : ADC<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x8B, Tr> : ADC<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x8C, Tr> : ADC<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x8D, Tr> : ADC<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x8E, Tr> : ADC<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x8F, Tr> : ADC<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x90, Tr> : SUB<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x91, Tr> : SUB<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x92, Tr> : SUB<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x93, Tr> : SUB<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x94, Tr> : SUB<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x95, Tr> : SUB<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x96, Tr> : SUB<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x97, Tr> : SUB<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0x98, Tr> : SBC<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0x99, Tr> : SBC<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0x9A, Tr> : SBC<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0x9B, Tr> : SBC<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0x9C, Tr> : SBC<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0x9D, Tr> : SBC<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0x9E, Tr> : SBC<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0x9F, Tr> : SBC<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0xA0, Tr> : AND<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0xA1, Tr> : AND<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0xA2, Tr> : AND<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0xA3, Tr> : AND<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0xA4, Tr> : AND<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0xA5, Tr> : AND<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0xA6, Tr> : AND<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0xA7, Tr> : AND<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0xA8, Tr> : XOR<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0xA9, Tr> : XOR<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0xAA, Tr> : XOR<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0xAB, Tr> : XOR<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0xAC, Tr> : XOR<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0xAD, Tr> : XOR<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0xAE, Tr> : XOR<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0xAF, Tr> : XOR<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0xB0, Tr> : OR<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0xB1, Tr> : OR<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0xB2, Tr> : OR<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0xB3, Tr> : OR<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0xB4, Tr> : OR<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0xB5, Tr> : OR<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0xB6, Tr> : OR<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0xB7, Tr> : OR<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0xB8, Tr> : CP<Register<A>, Register<B>> {};
+template <class Tr>
+struct Z80::Opcode<0xB9, Tr> : CP<Register<A>, Register<C>> {};
+template <class Tr>
+struct Z80::Opcode<0xBA, Tr> : CP<Register<A>, Register<D>> {};
+template <class Tr>
+struct Z80::Opcode<0xBB, Tr> : CP<Register<A>, Register<E>> {};
+template <class Tr>
+struct Z80::Opcode<0xBC, Tr> : CP<Register<A>, Register<H>> {};
+template <class Tr>
+struct Z80::Opcode<0xBD, Tr> : CP<Register<A>, Register<L>> {};
+template <class Tr>
+struct Z80::Opcode<0xBE, Tr> : CP<Register<A>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0xBF, Tr> : CP<Register<A>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0xC0, Tr> : RETNZ<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xC1, Tr> : POP<Register<BC>, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xC2, Tr> : JPNZ<NextWord, void> {};
+template <class Tr>
+struct Z80::Opcode<0xC3, Tr> : JP<NextWord, void> {};
+template <class Tr>
+struct Z80::Opcode<0xC4, Tr> : CALLNZ<NextWord, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xC5, Tr> : PUSH<Register<BC>, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xC6, Tr> : ADD<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xC7, Tr> : RST0<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xC8, Tr> : RETZ<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xC9, Tr> : RET<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xCA, Tr> : JPZ<NextWord, void> {};
+template <class Tr>
+struct Z80::Opcode<0xCB, Tr> : EXTENDED<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xCC, Tr> : CALLZ<NextWord, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xCD, Tr> : CALL<NextWord, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xCE, Tr> : ADC<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xCF, Tr> : RST8<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xD0, Tr> : RETNC<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xD1, Tr> : POP<Register<DE>, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xD2, Tr> : JPNC<NextWord, void> {};
+// 0xD3 is not a valid opcode
+template <class Tr>
+struct Z80::Opcode<0xD4, Tr> : CALLNC<NextWord, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xD5, Tr> : PUSH<Register<DE>, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xD6, Tr> : SUB<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xD7, Tr> : RST10<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xD8, Tr> : RETC<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xD9, Tr> : RETI<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xDA, Tr> : JPC<NextWord, void> {};
+// 0xDB is not a valid opcode
+template <class Tr>
+struct Z80::Opcode<0xDC, Tr> : CALLC<NextWord, Tr> {};
+// 0xDD is not a valid opcode
+template <class Tr>
+struct Z80::Opcode<0xDE, Tr> : SBC<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xDF, Tr> : RST18<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xE0, Tr> : LD<ToAddrFF00<NextByte, Tr>, Register<A>> {};
+template <class Tr>
+struct Z80::Opcode<0xE1, Tr> : POP<Register<HL>, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xE2, Tr> : LD<ToAddrFF00<Register<C>, Tr>, Register<A>> {};
+// 0xE3 is not a valid opcode
+// 0xE4 is not a valid opcode
+template <class Tr>
+struct Z80::Opcode<0xE5, Tr> : PUSH<Register<HL>, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xE6, Tr> : AND<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xE7, Tr> : RST20<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xE8, Tr> : ADDO<Register<SP>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xE9, Tr> : JP<Register<HL>, void> {};
+template <class Tr>
+struct Z80::Opcode<0xEA, Tr> : LD<ToAddr<NextWord, Tr>, Register<A>> {};
+// 0xEB is not a valid opcode
+// 0xEC is not a valid opcode
+// 0xED is not a valid opcode
+template <class Tr>
+struct Z80::Opcode<0xEE, Tr> : XOR<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xEF, Tr> : RST28<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xF0, Tr> : LD<Register<A>, ToAddrFF00<NextByte, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0xF1, Tr> : POP<Register<AF>, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xF2, Tr> : LD<Register<A>, ToAddrFF00<Register<C>, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0xF3, Tr> : DI<void, void> {};
+// 0xF4 is not a valid opcode
+template <class Tr>
+struct Z80::Opcode<0xF5, Tr> : PUSH<Register<AF>, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xF6, Tr> : OR<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xF7, Tr> : RST30<void, Tr> {};
+template <class Tr>
+struct Z80::Opcode<0xF8, Tr> : LDHLSPN<void, void> {};
+template <class Tr>
+struct Z80::Opcode<0xF9, Tr> : LDw<Register<SP>, Register<HL>> {};
+template <class Tr>
+struct Z80::Opcode<0xFA, Tr> : LD<Register<A>, ToAddr<NextWord, Tr>> {};
+template <class Tr>
+struct Z80::Opcode<0xFB, Tr> : EI<void, void> {};
+// 0xFC is not a valid opcode
+// 0xFD is not a valid opcode
+template <class Tr>
+struct Z80::Opcode<0xFE, Tr> : CP<Register<A>, NextByte> {};
+template <class Tr>
+struct Z80::Opcode<0xFF, Tr> : RST38<void, Tr> {};
+
+template <class Tr>
+struct Z80::CBOpcode<0x00, Tr> : RLC<Register<B>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x01, Tr> : RLC<Register<C>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x02, Tr> : RLC<Register<D>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x03, Tr> : RLC<Register<E>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x04, Tr> : RLC<Register<H>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x05, Tr> : RLC<Register<L>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x06, Tr> : RLC<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x07, Tr> : RLC<Register<A>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x08, Tr> : RRC<Register<B>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x09, Tr> : RRC<Register<C>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x0A, Tr> : RRC<Register<D>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x0B, Tr> : RRC<Register<E>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x0C, Tr> : RRC<Register<H>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x0D, Tr> : RRC<Register<L>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x0E, Tr> : RRC<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x0F, Tr> : RRC<Register<A>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x10, Tr> : RL<Register<B>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x11, Tr> : RL<Register<C>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x12, Tr> : RL<Register<D>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x13, Tr> : RL<Register<E>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x14, Tr> : RL<Register<H>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x15, Tr> : RL<Register<L>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x16, Tr> : RL<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x17, Tr> : RL<Register<A>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x18, Tr> : RR<Register<B>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x19, Tr> : RR<Register<C>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x1A, Tr> : RR<Register<D>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x1B, Tr> : RR<Register<E>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x1C, Tr> : RR<Register<H>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x1D, Tr> : RR<Register<L>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x1E, Tr> : RR<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x1F, Tr> : RR<Register<A>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x20, Tr> : SLA<Register<B>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x21, Tr> : SLA<Register<C>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x22, Tr> : SLA<Register<D>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x23, Tr> : SLA<Register<E>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x24, Tr> : SLA<Register<H>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x25, Tr> : SLA<Register<L>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x26, Tr> : SLA<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x27, Tr> : SLA<Register<A>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x28, Tr> : SRA<Register<B>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x29, Tr> : SRA<Register<C>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x2A, Tr> : SRA<Register<D>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x2B, Tr> : SRA<Register<E>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x2C, Tr> : SRA<Register<H>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x2D, Tr> : SRA<Register<L>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x2E, Tr> : SRA<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x2F, Tr> : SRA<Register<A>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x30, Tr> : SWAP<Register<B>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x31, Tr> : SWAP<Register<C>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x32, Tr> : SWAP<Register<D>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x33, Tr> : SWAP<Register<E>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x34, Tr> : SWAP<Register<H>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x35, Tr> : SWAP<Register<L>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x36, Tr> : SWAP<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x37, Tr> : SWAP<Register<A>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x38, Tr> : SRL<Register<B>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x39, Tr> : SRL<Register<C>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x3A, Tr> : SRL<Register<D>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x3B, Tr> : SRL<Register<E>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x3C, Tr> : SRL<Register<H>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x3D, Tr> : SRL<Register<L>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x3E, Tr> : SRL<ToAddr<Register<HL>, Tr>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x3F, Tr> : SRL<Register<A>, void> {};
+template <class Tr>
+struct Z80::CBOpcode<0x40, Tr> : BIT<I<0>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x41, Tr> : BIT<I<0>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x42, Tr> : BIT<I<0>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x43, Tr> : BIT<I<0>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x44, Tr> : BIT<I<0>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x45, Tr> : BIT<I<0>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x46, Tr> : BIT<I<0>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x47, Tr> : BIT<I<0>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x48, Tr> : BIT<I<1>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x49, Tr> : BIT<I<1>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x4A, Tr> : BIT<I<1>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x4B, Tr> : BIT<I<1>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x4C, Tr> : BIT<I<1>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x4D, Tr> : BIT<I<1>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x4E, Tr> : BIT<I<1>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x4F, Tr> : BIT<I<1>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x50, Tr> : BIT<I<2>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x51, Tr> : BIT<I<2>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x52, Tr> : BIT<I<2>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x53, Tr> : BIT<I<2>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x54, Tr> : BIT<I<2>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x55, Tr> : BIT<I<2>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x56, Tr> : BIT<I<2>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x57, Tr> : BIT<I<2>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x58, Tr> : BIT<I<3>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x59, Tr> : BIT<I<3>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x5A, Tr> : BIT<I<3>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x5B, Tr> : BIT<I<3>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x5C, Tr> : BIT<I<3>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x5D, Tr> : BIT<I<3>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x5E, Tr> : BIT<I<3>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x5F, Tr> : BIT<I<3>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x60, Tr> : BIT<I<4>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x61, Tr> : BIT<I<4>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x62, Tr> : BIT<I<4>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x63, Tr> : BIT<I<4>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x64, Tr> : BIT<I<4>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x65, Tr> : BIT<I<4>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x66, Tr> : BIT<I<4>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x67, Tr> : BIT<I<4>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x68, Tr> : BIT<I<5>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x69, Tr> : BIT<I<5>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x6A, Tr> : BIT<I<5>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x6B, Tr> : BIT<I<5>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x6C, Tr> : BIT<I<5>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x6D, Tr> : BIT<I<5>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x6E, Tr> : BIT<I<5>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x6F, Tr> : BIT<I<5>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x70, Tr> : BIT<I<6>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x71, Tr> : BIT<I<6>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x72, Tr> : BIT<I<6>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x73, Tr> : BIT<I<6>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x74, Tr> : BIT<I<6>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x75, Tr> : BIT<I<6>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x76, Tr> : BIT<I<6>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x77, Tr> : BIT<I<6>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x78, Tr> : BIT<I<7>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x79, Tr> : BIT<I<7>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x7A, Tr> : BIT<I<7>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x7B, Tr> : BIT<I<7>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x7C, Tr> : BIT<I<7>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x7D, Tr> : BIT<I<7>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x7E, Tr> : BIT<I<7>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x7F, Tr> : BIT<I<7>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x80, Tr> : RES<I<0>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x81, Tr> : RES<I<0>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x82, Tr> : RES<I<0>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x83, Tr> : RES<I<0>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x84, Tr> : RES<I<0>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x85, Tr> : RES<I<0>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x86, Tr> : RES<I<0>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x87, Tr> : RES<I<0>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x88, Tr> : RES<I<1>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x89, Tr> : RES<I<1>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x8A, Tr> : RES<I<1>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x8B, Tr> : RES<I<1>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x8C, Tr> : RES<I<1>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x8D, Tr> : RES<I<1>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x8E, Tr> : RES<I<1>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x8F, Tr> : RES<I<1>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x90, Tr> : RES<I<2>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x91, Tr> : RES<I<2>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x92, Tr> : RES<I<2>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x93, Tr> : RES<I<2>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x94, Tr> : RES<I<2>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x95, Tr> : RES<I<2>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x96, Tr> : RES<I<2>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x97, Tr> : RES<I<2>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x98, Tr> : RES<I<3>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x99, Tr> : RES<I<3>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x9A, Tr> : RES<I<3>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x9B, Tr> : RES<I<3>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x9C, Tr> : RES<I<3>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x9D, Tr> : RES<I<3>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x9E, Tr> : RES<I<3>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0x9F, Tr> : RES<I<3>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA0, Tr> : RES<I<4>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA1, Tr> : RES<I<4>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA2, Tr> : RES<I<4>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA3, Tr> : RES<I<4>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA4, Tr> : RES<I<4>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA5, Tr> : RES<I<4>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA6, Tr> : RES<I<4>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA7, Tr> : RES<I<4>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA8, Tr> : RES<I<5>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xA9, Tr> : RES<I<5>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xAA, Tr> : RES<I<5>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xAB, Tr> : RES<I<5>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xAC, Tr> : RES<I<5>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xAD, Tr> : RES<I<5>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xAE, Tr> : RES<I<5>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xAF, Tr> : RES<I<5>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB0, Tr> : RES<I<6>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB1, Tr> : RES<I<6>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB2, Tr> : RES<I<6>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB3, Tr> : RES<I<6>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB4, Tr> : RES<I<6>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB5, Tr> : RES<I<6>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB6, Tr> : RES<I<6>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB7, Tr> : RES<I<6>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB8, Tr> : RES<I<7>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xB9, Tr> : RES<I<7>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xBA, Tr> : RES<I<7>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xBB, Tr> : RES<I<7>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xBC, Tr> : RES<I<7>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xBD, Tr> : RES<I<7>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xBE, Tr> : RES<I<7>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xBF, Tr> : RES<I<7>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC0, Tr> : SET<I<0>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC1, Tr> : SET<I<0>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC2, Tr> : SET<I<0>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC3, Tr> : SET<I<0>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC4, Tr> : SET<I<0>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC5, Tr> : SET<I<0>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC6, Tr> : SET<I<0>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC7, Tr> : SET<I<0>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC8, Tr> : SET<I<1>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xC9, Tr> : SET<I<1>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xCA, Tr> : SET<I<1>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xCB, Tr> : SET<I<1>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xCC, Tr> : SET<I<1>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xCD, Tr> : SET<I<1>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xCE, Tr> : SET<I<1>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xCF, Tr> : SET<I<1>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD0, Tr> : SET<I<2>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD1, Tr> : SET<I<2>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD2, Tr> : SET<I<2>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD3, Tr> : SET<I<2>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD4, Tr> : SET<I<2>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD5, Tr> : SET<I<2>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD6, Tr> : SET<I<2>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD7, Tr> : SET<I<2>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD8, Tr> : SET<I<3>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xD9, Tr> : SET<I<3>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xDA, Tr> : SET<I<3>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xDB, Tr> : SET<I<3>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xDC, Tr> : SET<I<3>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xDD, Tr> : SET<I<3>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xDE, Tr> : SET<I<3>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xDF, Tr> : SET<I<3>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE0, Tr> : SET<I<4>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE1, Tr> : SET<I<4>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE2, Tr> : SET<I<4>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE3, Tr> : SET<I<4>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE4, Tr> : SET<I<4>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE5, Tr> : SET<I<4>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE6, Tr> : SET<I<4>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE7, Tr> : SET<I<4>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE8, Tr> : SET<I<5>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xE9, Tr> : SET<I<5>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xEA, Tr> : SET<I<5>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xEB, Tr> : SET<I<5>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xEC, Tr> : SET<I<5>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xED, Tr> : SET<I<5>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xEE, Tr> : SET<I<5>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xEF, Tr> : SET<I<5>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF0, Tr> : SET<I<6>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF1, Tr> : SET<I<6>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF2, Tr> : SET<I<6>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF3, Tr> : SET<I<6>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF4, Tr> : SET<I<6>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF5, Tr> : SET<I<6>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF6, Tr> : SET<I<6>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF7, Tr> : SET<I<6>, Register<A>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF8, Tr> : SET<I<7>, Register<B>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xF9, Tr> : SET<I<7>, Register<C>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xFA, Tr> : SET<I<7>, Register<D>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xFB, Tr> : SET<I<7>, Register<E>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xFC, Tr> : SET<I<7>, Register<H>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xFD, Tr> : SET<I<7>, Register<L>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xFE, Tr> : SET<I<7>, ToAddr<Register<HL>, Tr>> {};
+template <class Tr>
+struct Z80::CBOpcode<0xFF, Tr> : SET<I<7>, Register<A>> {};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Tells which subsystem the emulator is in, for a sampling profiler to
+// attribute host time: zones nest, the innermost one is current, and
+// whatever runs outside of any zone is the CPU's. Timing every bus access
+// would cost more than the access, so entering a zone only costs a couple
+// of stores, and nothing at all while disabled.
+class Profiler {
+   public:
+    enum Zone { CPU, BUS, VIDEO, RENDER, APU, DEVICES };
+    static const int kNbZones = DEVICES + 1;
+
+    Profiler() : enabled(false) { Reset(); }
+
+    void Reset() {
+        _samples.fill(0);
+        _calls.fill(0);
+        _zone = CPU;
+    }
+
+    Zone Enter(Zone z) {
+        ++_calls[z];
+        Zone prev = Zone(_zone);
+        _zone = z;
+        return prev;
+    }
+    void Leave(Zone prev) { _zone = prev; }
+
+    // Meant to be called periodically, from a timer signal handler.
+    void Sample() { ++_samples[_zone]; }
+
+    uint64_t samples(Zone z) const { return _samples[z]; }
+    uint64_t calls(Zone z) const { return _calls[z]; }
+
+    static const char* name(Zone z) {
+        static const char* names[] = {"cpu",    "bus", "video",
+                                      "render", "apu", "devices"};
+        return names[z];
+    }
+
+    bool enabled;
+
+   private:
+    std::array<uint64_t, kNbZones> _samples;
+    std::array<uint64_t, kNbZones> _calls;
+    volatile int _zone;
+};
+
+extern Profiler profiler;
+
+class ProfileScope {
+   public:
+    ProfileScope(Profiler::Zone z)
+        : _active(profiler.enabled), _prev(Profiler::CPU) {
+        if (_active) {
+            _prev = profiler.Enter(z);
+        }
+    }
+    ~ProfileScope() {
+        if (_active) {
+            profiler.Leave(_prev);
+        }
+    }
+
+   private:
+    bool _active;
+    Profiler::Zone _prev;
+};
@@ -0,0 +1,126 @@
+#include "ramfile.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Makes a rename in the directory of filename durable
+bool SyncDirectory(const std::string& filename) {
+    const size_t slash = filename.rfind('/');
+    const std::string dir =
+        slash == std::string::npos ? "." : filename.substr(0, slash + 1);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+// Returns a descriptor on filename, at least size bytes long, or -1. Only a
+// missing file is created: one that can't be opened is left alone.
+int OpenSized(const std::string& filename, size_t size) {
+    std::vector<byte> old;
+    mode_t mode = 0644;
+    int fd = open(filename.c_str(), O_RDWR);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            return -1;
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            return -1;
+        }
+        if (size_t(st.st_size) >= size) {
+            return fd;
+        }
+        old.resize(st.st_size);
+        const bool read =
+            pread(fd, old.data(), old.size(), 0) == ssize_t(old.size());
+        close(fd);
+        if (!read) {
+            return -1;
+        }
+        mode = st.st_mode & 07777;
+    }
+
+    const std::string tmp = filename + ".tmp";
+    fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, mode);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fchmod(fd, mode) != 0 ||
+        pwrite(fd, old.data(), old.size(), 0) != ssize_t(old.size()) ||
+        ftruncate(fd, size) != 0 || fsync(fd) != 0 ||
+        rename(tmp.c_str(), filename.c_str()) != 0 ||
+        !SyncDirectory(filename)) {
+        close(fd);
+        unlink(tmp.c_str());
+        return -1;
+    }
+    return fd;
+}
+
+}  // namespace
+
+RamFile::RamFile(size_t size) : _data(nullptr), _size(size), _fd(-1) {
+    void* data = mmap(nullptr,
+                      size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Can't allocate the cartridge RAM");
+    }
+    _data = static_cast<byte*>(data);
+}
+
+RamFile::RamFile(const std::string& filename, size_t size)
+    : _data(nullptr), _size(size), _fd(OpenSized(filename, size)) {
+    if (_fd < 0) {
+        throw std::runtime_error("Can't open " + filename);
+    }
+    if (flock(_fd, LOCK_EX | LOCK_NB) != 0) {
+        close(_fd);
+        throw std::runtime_error(filename + " is used by another instance");
+    }
+    void* data =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (data == MAP_FAILED) {
+        close(_fd);
+        throw std::runtime_error("Can't map " + filename);
+    }
+    _data = static_cast<byte*>(data);
+}
+
+RamFile::~RamFile() {
+    munmap(_data, _size);
+    if (_fd >= 0) {
+        close(_fd);
+    }
+}
+
+// msync(MS_ASYNC) does nothing on Linux, where the dirty pages already are in
+// the page cache: they have to be queued for writing explicitly.
+void RamFile::Flush() {
+    if (_fd < 0) {
+        return;
+    }
+#ifdef SYNC_FILE_RANGE_WRITE
+    sync_file_range(_fd, 0, _size, SYNC_FILE_RANGE_WRITE);
+#else
+    fdatasync(_fd);
+#endif
+}
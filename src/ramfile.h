@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "utils.h"
+
+// Cartridge RAM, mapped so that the kernel only allocates the pages a game
+// writes to. Battery backed RAM is mapped from its save file: writes land in
+// the page cache right away, so they survive the process crashing, and
+// nothing has to be written back on exit.
+class RamFile {
+   public:
+    // Maps size bytes of zeroes, for RAM without a battery
+    explicit RamFile(size_t size);
+    // Maps size bytes of filename. A missing or shorter file is first
+    // completed in a temporary file renamed over it, with the same
+    // permissions, so that a crash never leaves a truncated save behind. The
+    // file stays locked while mapped. Throws if it exists but can't be opened
+    // for writing, can't be mapped, or is already.
+    RamFile(const std::string& filename, size_t size);
+    ~RamFile();
+
+    byte* data() const { return _data; }
+    size_t size() const { return _size; }
+
+    // Starts writing the RAM back to its file. Only waits for it on hosts
+    // that can't queue the write.
+    void Flush();
+
+    RamFile(const RamFile&) = delete;
+    RamFile& operator=(const RamFile&) = delete;
+
+   private:
+    byte* _data;
+    size_t _size;
+    // -1 without a file
+    int _fd;
+};
@@ -68,10 +68,10 @@ struct Z80::Register<Z80::A> {
 template <>
 struct Z80::Register<Z80::F> {
     static const int cycles = 0;
-    static inline Data8 Get(const Z80* proc) { return proc->_regs[6]; }
+    static inline Data8 Get(const Z80* proc) { return proc->flags(); }
 
-    static inline void Set(Z80* proc, Data8 val) { proc->_regs[6].u = val.u; }
-    static void Print(Z80* p) { cinstr << "F(" << p->_regs[6] << ")"; }
+    static inline void Set(Z80* proc, Data8 val) { proc->set_flags(val.u); }
+    static void Print(Z80* p) { cinstr << "F(" << Get(p) << ")"; }
 };
 
 template <>
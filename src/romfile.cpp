@@ -0,0 +1,55 @@
+#include "romfile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+std::shared_ptr<const RomFile> RomFile::Load(const std::string& filename) {
+    // Files are told apart by inode, whatever the path they're opened by
+    typedef std::pair<dev_t, ino_t> Key;
+    static std::mutex mutex;
+    static std::map<Key, std::weak_ptr<const RomFile>> loaded;
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Can't open " + filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0x150) {
+        close(fd);
+        throw std::runtime_error(filename + " is not a ROM");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::weak_ptr<const RomFile>& entry = loaded[{st.st_dev, st.st_ino}];
+    std::shared_ptr<const RomFile> rom = entry.lock();
+    if (!rom) {
+        // Banks are mapped whole, pages past the end of the file would fault:
+        // the file is mapped over zeros up to the next bank.
+        const size_t size = std::max<size_t>(
+            0x8000, (size_t(st.st_size) + 0x3FFF) & ~size_t(0x3FFF));
+        void* data = mmap(nullptr, size, PROT_READ,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED ||
+            mmap(data, st.st_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd,
+                 0) == MAP_FAILED) {
+            if (data != MAP_FAILED) {
+                munmap(data, size);
+            }
+            close(fd);
+            throw std::runtime_error("Can't map " + filename);
+        }
+        rom.reset(new RomFile(static_cast<const byte*>(data), size));
+        entry = rom;
+    }
+    close(fd);
+    return rom;
+}
+
+RomFile::~RomFile() { munmap(const_cast<byte*>(_data), _size); }
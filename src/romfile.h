@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "utils.h"
+
+// A ROM file mapped read-only. Pages are only read from the disk when first
+// touched, and all the cartridges of the process loading the same file share
+// one mapping, released with the last of them. Files are padded with zeros to
+// whole 16 KB banks, two at least, so that every bank can be mapped.
+class RomFile {
+   public:
+    // Throws if filename can't be mapped
+    static std::shared_ptr<const RomFile> Load(const std::string& filename);
+    ~RomFile();
+
+    const byte* data() const { return _data; }
+    // A multiple of the bank size, the padding included
+    size_t size() const { return _size; }
+
+    RomFile(const RomFile&) = delete;
+    RomFile& operator=(const RomFile&) = delete;
+
+   private:
+    RomFile(const byte* data, size_t size) : _data(data), _size(size) {}
+
+    const byte* _data;
+    size_t _size;
+};
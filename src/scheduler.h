@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "state.h"
+
+constexpr uint64_t kNever = ~uint64_t(0);
+
+// Machine-wide cycle counter and event queue. Instead of being clocked on
+// every T-cycle, devices register the cycle of their next state change and
+// the CPU runs instructions until the nearest one.
+class Scheduler {
+   public:
+    enum Event { PPU, TIMER, SERIAL, APU, DMA };
+    static const int kNbEvents = DMA + 1;
+
+    Scheduler() : _now(0), _next(kNever), _next_event(PPU) {
+        _deadlines.fill(kNever);
+    }
+
+    uint64_t now() const { return _now; }
+    void Advance(int cycles) { _now += cycles; }
+
+    // An event is handled before any instruction starting at or after its
+    // deadline.
+    bool due() const { return _now >= _next; }
+    uint64_t next_deadline() const { return _next; }
+    Event next_event() const { return _next_event; }
+    uint64_t deadline(Event e) const { return _deadlines[e]; }
+
+    // Handling an event must either reschedule or cancel it.
+    void Schedule(Event e, uint64_t cycle) {
+        _deadlines[e] = cycle;
+        UpdateNext();
+    }
+    void Cancel(Event e) { Schedule(e, kNever); }
+
+    void SaveState(StateWriter& w) const {
+        w.Write(_now);
+        w.Write(_deadlines);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(_now);
+        r.Read(_deadlines);
+        UpdateNext();
+    }
+
+   private:
+    // There is only a handful of event kinds: a linear scan is cheaper than
+    // maintaining a heap.
+    void UpdateNext() {
+        _next = kNever;
+        for (int i = 0; i < kNbEvents; ++i) {
+            if (_deadlines[i] < _next) {
+                _next = _deadlines[i];
+                _next_event = Event(i);
+            }
+        }
+    }
+
+    uint64_t _now;
+    uint64_t _next;
+    Event _next_event;
+    std::array<uint64_t, kNbEvents> _deadlines;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+
+// Save states are the raw bytes of every component, written one after the
+// other in a fixed order behind a small header. There is no per-field
+// tagging: any change to what a component saves must bump kStateVersion.
+constexpr uint32_t kStateMagic = 0x54534247;  // "GBST"
+constexpr uint32_t kStateVersion = 8;
+
+class StateWriter {
+   public:
+    // Appends to buf, which keeps its capacity from one snapshot to the
+    // next.
+    StateWriter(std::vector<byte>& buf) : _buf(buf) {}
+
+    void WriteBytes(const void* data, size_t size) {
+        const byte* p = static_cast<const byte*>(data);
+        _buf.insert(_buf.end(), p, p + size);
+    }
+
+    template <class T>
+    void Write(const T& x) {
+        static_assert(std::is_standard_layout<T>::value &&
+                          !std::is_pointer<T>::value,
+                      "only plain data can be saved as is");
+        WriteBytes(&x, sizeof(x));
+    }
+
+    template <class T>
+    void Write(const std::vector<T>& v) {
+        Write(uint32_t(v.size()));
+        WriteBytes(v.data(), v.size() * sizeof(T));
+    }
+
+   private:
+    std::vector<byte>& _buf;
+};
+
+class StateReader {
+   public:
+    StateReader(const std::vector<byte>& buf)
+        : _data(buf.data()), _size(buf.size()), _pos(0) {}
+
+    void ReadBytes(void* data, size_t size) {
+        if (_pos + size > _size) {
+            throw std::runtime_error("Truncated save state");
+        }
+        memcpy(data, _data + _pos, size);
+        _pos += size;
+    }
+
+    template <class T>
+    void Read(T& x) {
+        static_assert(std::is_standard_layout<T>::value &&
+                          !std::is_pointer<T>::value,
+                      "only plain data can be loaded as is");
+        ReadBytes(&x, sizeof(x));
+    }
+
+    // Vectors are sized by the emulated hardware, not by the save state
+    template <class T>
+    void Read(std::vector<T>& v) {
+        uint32_t size;
+        Read(size);
+        if (size != v.size()) {
+            throw std::runtime_error("Save state doesn't match the machine");
+        }
+        ReadBytes(v.data(), v.size() * sizeof(T));
+    }
+
+   private:
+    const byte* _data;
+    size_t _size;
+    size_t _pos;
+};
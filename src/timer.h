@@ -1,79 +1,151 @@
 #pragma once
 
+#include <cstdint>
+
+#include "scheduler.h"
+#include "state.h"
 #include "utils.h"
 
+// DIV is the upper byte of a 16 bits counter running since the last DIV
+// write, so it is computed from the machine clock when read. TIMA counts the
+// falling edges of one bit of that counter, selected by TAC, and is only
+// brought up to date when accessed. Its next overflow is registered in the
+// scheduler so that the interrupt is raised on time.
 class Timer {
    public:
-    Timer()
-        : cnt_(uint8_t(0)),
-          cycle_(kCpuFreq / 16384),
-          div_cycle_cnt_(0),
-          tima_cycle_cnt_(0),
+    Timer(Scheduler& sched)
+        : div_reset_(0),
           tima_(uint8_t(0)),
-          tma_(uint8_t(0)) {}
+          tma_(uint8_t(0)),
+          tac_(uint8_t(0)),
+          int_(false),
+          sched_(sched),
+          synced_(0) {}
 
-    void Clock() {
+    // Runs the TIMA overflow that is due, and schedules the next one. Returns
+    // whether the timer interrupt must be raised.
+    bool Step() {
+        Sync();
+        bool overflowed = int_;
         int_ = false;
-        ++div_cycle_cnt_;
-        if (div_cycle_cnt_ == cycle_) {
-            ++cnt_.u;
-            div_cycle_cnt_ = 0;
+        ScheduleOverflow();
+        return overflowed;
+    }
+
+    // Writing DIV clears the whole counter: if the bit TIMA watches was set,
+    // that is a falling edge too.
+    void Reset() {
+        Sync();
+        bool input = Input();
+        div_reset_ = synced_;
+        if (input && !Input()) {
+            Tick(1);
         }
+        ScheduleOverflow();
+    }
+    Data8 div() const { return uint8_t(Counter() >> 8); }
+
+    Data8 tima() {
+        Sync();
+        return tima_;
+    }
+    void set_tima(Data8 tima) {
+        Sync();
+        tima_ = tima;
+        ScheduleOverflow();
+    }
+
+    Data8 tma() const { return tma_; }
+    void set_tma(Data8 tma) {
+        Sync();
+        tma_ = tma;
+    }
 
-        if ((tac_.u & 0b100) == 0) {
-            return;
+    Data8 tac() const { return tac_; }
+    // Disabling the timer or selecting another bit can fall the edge as well
+    void set_tac(Data8 tac) {
+        Sync();
+        bool input = Input();
+        tac_ = tac;
+        if (input && !Input()) {
+            Tick(1);
         }
+        ScheduleOverflow();
+    }
 
-        ++tima_cycle_cnt_;
-        if (tima_cycle_cnt_ >= TimerFreq()) {
-            tima_cycle_cnt_ = 0;
-            ++tima_.u;
-            if (tima_.u == 0) {
-                tima_.u = tma_.u;
-                int_ = true;
-            }
+    // Cycle of the next TIMA overflow, kNever while stopped
+    uint64_t next_overflow() const {
+        if (!enabled()) {
+            return kNever;
         }
+        const uint64_t period = Period();
+        uint64_t edges = (synced_ - div_reset_) / period + 256 - tima_.u;
+        return div_reset_ + edges * period;
     }
 
-    void Reset() {
-        cnt_.u = 0;
-        tima_cycle_cnt_ = 1;
+    void SaveState(StateWriter& w) const {
+        w.Write(div_reset_);
+        w.Write(tima_);
+        w.Write(tma_);
+        w.Write(tac_);
+        w.Write(int_);
+        w.Write(synced_);
+    }
+    void LoadState(StateReader& r) {
+        r.Read(div_reset_);
+        r.Read(tima_);
+        r.Read(tma_);
+        r.Read(tac_);
+        r.Read(int_);
+        r.Read(synced_);
     }
-    Data8 div() const { return cnt_; }
 
-    Data8 tima() const { return tima_; }
-    void set_tima(Data8 tima) { tima_ = tima; }
+   private:
+    bool enabled() const { return tac_.u & 0b100; }
 
-    Data8 tma() const { return tma_; }
-    void set_tma(Data8 tma) { tma_ = tma; }
+    // TIMA ticks once per period, when bit log2(period) - 1 of the counter
+    // falls.
+    int Period() const {
+        static const int periods[] = {1024, 16, 64, 256};
+        return periods[tac_.u & 0b11];
+    }
 
-    Data8 tac() const { return tac_; }
-    void set_tac(Data8 tac) { tac_ = tac; }
+    uint16_t Counter() const { return uint16_t(sched_.now() - div_reset_); }
+    bool Input() const { return enabled() && (Counter() & (Period() / 2)); }
 
-    bool tima_int() const { return int_; }
+    void Tick(uint64_t ticks) {
+        while (ticks >= 256u - tima_.u) {
+            ticks -= 256u - tima_.u;
+            tima_.u = tma_.u;
+            int_ = true;
+        }
+        tima_.u += ticks;
+    }
 
-   private:
-    int TimerFreq() const {
-        switch (tac_.u & 0b11) {
-            case 0:
-                return 1024;
-            case 1:
-                return 16;
-            case 2:
-                return 64;
-            case 3:
-                return 256;
+    // Catches up with the machine clock: TIMA then holds the value seen by an
+    // access happening on the current cycle.
+    void Sync() {
+        const uint64_t now = sched_.now();
+        if (enabled()) {
+            const uint64_t period = Period();
+            Tick((now - div_reset_) / period -
+                 (synced_ - div_reset_) / period);
         }
-        assert(false);
-        return 0;
+        synced_ = now;
+    }
+
+    // An overflow caused by a write is raised right away
+    void ScheduleOverflow() {
+        sched_.Schedule(Scheduler::TIMER, int_ ? synced_ : next_overflow());
     }
 
-    Data8 cnt_;
-    const int cycle_;
-    int div_cycle_cnt_;
-    int tima_cycle_cnt_;
+    // Cycle the counter was cleared at
+    uint64_t div_reset_;
     Data8 tima_;
     Data8 tma_;
     Data8 tac_;
     bool int_;
+    Scheduler& sched_;
+    // Cycle TIMA is up to date with
+    uint64_t synced_;
 };
@@ -0,0 +1,10 @@
+#include "utils.h"
+#include "profiler.h"
+
+Logger cinstr;
+Logger cdebug;
+Logger cevent;
+Logger cerror;
+Logger serial;
+
+Profiler profiler;
@@ -2,16 +2,32 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include "addressbus.h"
+#include "aot.h"
+#include "blockcache.h"
+#include "jit.h"
+#include "scheduler.h"
+#include "state.h"
 
 typedef unsigned char byte;
 typedef uint16_t word;
 
+// Tracing policies the interpreter is compiled with. Untraced, instructions
+// don't even compute what they would have printed to cinstr.
+struct NoTrace {
+    static const bool enabled = false;
+};
+struct Traced {
+    static const bool enabled = true;
+};
+
 class Sound;
 class Video;
 class LinkCable;
 class Timer;
 class Keypad;
+class Interrupts;
 
 class Z80 {
    public:
@@ -20,22 +36,22 @@ class Z80 {
         LinkCable& lk,
         Timer& timer,
         Sound& s,
-        Keypad& k);
-
-    void Process();
-
-    class InstrBase {
-       public:
-        virtual int Do(Z80*) = 0;
-        virtual void Print(Z80*) = 0;
-    };
-
-    template <template <class, class> class Action, class Op1, class Op2>
-    class Instr : public InstrBase {
-       public:
-        int Do(Z80* p) override { return Action<Op1, Op2>::Do(p); }
-        void Print(Z80* p) override { Action<Op1, Op2>::Print(p); }
-    };
+        Keypad& k,
+        Interrupts& ints,
+        Scheduler& sched);
+
+    // Runs the machine until poweroff, or until the first instruction
+    // boundary at or after the cycle `until`. Devices are only stepped when
+    // the scheduler reaches one of their deadlines. Runs the traced
+    // interpreter if cinstr is enabled when called.
+    void Process(uint64_t until = kNever);
+
+    // Opcode<op, Tr> and CBOpcode<op, Tr> are the Action<Op1, Op2>
+    // instantiations implementing each opcode, see opcodes.hpp.
+    template <byte Op, class Tr>
+    struct Opcode;
+    template <byte Op, class Tr>
+    struct CBOpcode;
 
     enum RegName { A, B, C, D, E, F, H, L, AF, BC, DE, HL, SP, PC };
     template <RegName>
@@ -45,52 +61,118 @@ class Z80 {
     static void PrintInstr(uint8_t pc, Z80* p);
     static void PrintCBInstr(uint8_t pc, Z80* p);
     void Dump() const;
+    template <class Tr>
     int RunOpcode(byte opcode);
+    template <class Tr>
     int RunCBOpcode(byte opcode);
 
-    bool zero_f() const { return GetBit(_regs[6].u, 7); }
-    void set_zero_f(bool v) { _regs[6].u = WriteBit(_regs[6].u, 7, v); }
-
-    bool sub_f() const { return GetBit(_regs[6].u, 6); }
-    void set_sub_f(bool v) { _regs[6].u = WriteBit(_regs[6].u, 6, v); }
-
-    bool hcarry_f() const { return GetBit(_regs[6].u, 5); }
-    void set_hcarry_f(bool v) { _regs[6].u = WriteBit(_regs[6].u, 5, v); }
-
-    bool carry_f() const { return GetBit(_regs[6].u, 4); }
-    void set_carry_f(bool v) { _regs[6].u = WriteBit(_regs[6].u, 4, v); }
+    // Untraced handler of an opcode and its length with its operand, for
+    // decoding ahead of time.
+    typedef int (*Handler)(Z80*);
+    static Handler handler(byte opcode);
+    static int length(byte opcode);
+
+    // F is computed lazily: ADD, ADC, SUB, SBC, CP, INC and DEC only record
+    // their result, and Z is derived when read. Conditions only test Z and C,
+    // which are cheap to get from the record.
+    byte flags() const {
+        if (!_lazy_flags) {
+            return _regs[6].u;
+        }
+        return ((_lazy_flags & 0xFF) == 0) << 7 | ((_lazy_flags >> 8) & 0x60) |
+               ((_lazy_flags >> 4) & 0x10);
+    }
+    void set_flags(byte f) {
+        _regs[6].u = f;
+        _lazy_flags = 0;
+    }
+    // res is a + b, plus the carry for ADC, with the carry out in bit 8. INC
+    // adds 1 and passes the carry it keeps in bit 8.
+    void set_add_flags(byte a, byte b, unsigned res) {
+        _lazy_flags = kLazy | (res & 0x1FF) | ((a ^ b ^ res) & 0x10) << 9;
+    }
+    // Same for a - b, with the borrow in bit 8
+    void set_sub_flags(byte a, byte b, unsigned res) {
+        _lazy_flags =
+            kLazy | 0x4000 | (res & 0x1FF) | ((a ^ b ^ res) & 0x10) << 9;
+    }
+
+    bool zero_f() const {
+        return _lazy_flags ? (_lazy_flags & 0xFF) == 0
+                           : GetBit(_regs[6].u, 7);
+    }
+    void set_zero_f(bool v) { set_flags(WriteBit(flags(), 7, v)); }
+
+    bool sub_f() const { return GetBit(flags(), 6); }
+    void set_sub_f(bool v) { set_flags(WriteBit(flags(), 6, v)); }
+
+    bool hcarry_f() const { return GetBit(flags(), 5); }
+    void set_hcarry_f(bool v) { set_flags(WriteBit(flags(), 5, v)); }
+
+    bool carry_f() const {
+        return _lazy_flags ? (_lazy_flags >> 8) & 1
+                           : GetBit(_regs[6].u, 4);
+    }
+    void set_carry_f(bool v) { set_flags(WriteBit(flags(), 4, v)); }
 
     void next_opcode() { ++_pc.u; }
 
     bool halted() const { return _halted; }
     void set_halt(bool x) { _halted = x; }
+    // Unlike HALT, STOP is only left on a key press
+    bool stopped() const { return _stopped; }
+    void set_stop(bool x) { _stopped = x; }
 
     void poweroff() { _power = false; }
 
     Data16 pc() const { return _pc; }
     Data16& pc() { return _pc; }
     AddressBus& addr() { return _addr; }
+    // Instructions executed since power on
+    uint64_t instructions() const { return _instructions; }
+    // Runs hot blocks as native code, on hosts supporting it. Off by default.
+    void set_jit(bool enabled);
+    // Runs the blocks compiled ahead of time by tools/aot.py in filename
+    void LoadAot(const std::string& filename);
+    // Where the ROM blocks run so far start, as tools/aot.py reads them
+    void WriteCoverage(std::ostream& out) const;
+
+    void SaveState(StateWriter& w) const;
+    void LoadState(StateReader& r);
 
    private:
-    template <unsigned char Opcode, class Instr>
-    void RegisterOpcode();
-
-    template <unsigned char Opcode, class Inst>
-    void RegisterCBOpcode();
-
+    template <class Tr>
+    void Run(uint64_t until);
+    template <class Tr>
     int ProcessInterrupts();
+    // Run the instruction at pc, decoding it on the spot or from the block
+    // cache.
+    template <class Tr>
+    int Interpret();
+    int RunCached(uint64_t until);
+    // Runs the translation of block, translating it once hot, if it can't
+    // cross a deadline or until. Returns 0 if nothing ran.
+    int RunNative(BlockCache::Block& block, uint64_t until);
+    void ProcessEvent(Scheduler::Event e);
+    // Only scheduled events can wake the CPU up: instead of idling 4 cycles
+    // at a time, jumps to the first 4 cycles step at or after the next one.
+    int IdleCycles(uint64_t until) const;
 
     friend struct NextWord;
     friend struct NextByte;
-    template <class>
+    template <class, class>
     friend struct ToAddr;
-    template <class>
+    template <class, class>
     friend struct ToAddrFF00;
 
     template <class, class>
     friend struct HALT;
 
     Data8 _regs[8];
+    // 0 when F is in _regs[6]. Otherwise kLazy, the result and carry of the
+    // last operation in bits 0-8, and its N and H flags in bits 14 and 13.
+    static const uint32_t kLazy = 0x10000;
+    uint32_t _lazy_flags;
     Data16 _sp;
     Data16 _pc;
     AddressBus& _addr;
@@ -99,9 +181,21 @@ class Z80 {
     Sound& _snd;
     Timer& _timer;
     Keypad& _keypad;
-    static std::array<std::unique_ptr<InstrBase>, 256> _instr;
-    static std::array<std::unique_ptr<InstrBase>, 256> _cb_instr;
-    byte _interrupts;
+    Interrupts& _ints;
+    Scheduler& _sched;
+    BlockCache _blocks;
+    // Next instruction of the current block, valid as long as the code
+    // version doesn't change and pc matches.
+    const BlockCache::Op* _op;
+    const BlockCache::Op* _op_end;
+    uint32_t _code_version;
+    std::unique_ptr<Jit> _jit;
+    std::unique_ptr<Aot> _aot;
+    AddressBus::PlainMemory _plain_memory;
+    // Operand of the instruction being run, read by NextByte and NextWord
+    Data16 _imm;
     bool _halted;
+    bool _stopped;
     bool _power;
+    uint64_t _instructions;
 };
@@ -1,81 +1,194 @@
 #include "z80.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 
+#include "apu/sound.h"
 #include "gpu/video.h"
 #include "instruction.hpp"
+#include "interrupts.h"
 #include "keypad.h"
 #include "link.h"
+#include "profiler.h"
 #include "timer.h"
 
-void Z80::Process() {
-    int cycles = 0;
-    while (_power && !_keypad.poweroff()) {
-        if (!halted()) {
-            if (cycles == 0) {
-                cinstr << "0x" << std::hex << _pc.u << "\t"
-                       << int(_addr.Get(_pc.u).u) << "\t";
-                PrintInstr(_addr.Get(_pc.u).u, this);
-                cycles = RunOpcode(_addr.Get(_pc.u).u);
+void Z80::Process(uint64_t until) {
+    if (cinstr.enabled) {
+        Run<Traced>(until);
+    } else {
+        Run<NoTrace>(until);
+    }
+}
+
+template <class Tr>
+void Z80::Run(uint64_t until) {
+    while (_power && !_keypad.poweroff() && _sched.now() < until) {
+        while (_sched.due()) {
+            ProcessEvent(_sched.next_event());
+        }
+
+        int cycles = stopped() ? 0 : ProcessInterrupts<Tr>();
+        if (cycles == 0) {
+            if (halted() || stopped()) {
+                cycles = IdleCycles(until);
+            } else {
+                cycles = Tr::enabled ? Interpret<Tr>() : RunCached(until);
             }
-            --cycles;
         }
+        _sched.Advance(cycles);
+    }
+}
 
-        _vid.set_maxspeed(_keypad.max_speed());
-        _vid.Clock();
-        _lk.Clock();
-        _timer.Clock();
+template <class Tr>
+int Z80::Interpret() {
+    byte op = _addr.Get(_pc.u).u;
+    if (Tr::enabled) {
+        cinstr << "0x" << std::hex << _pc.u << "\t" << int(op) << "\t";
+        PrintInstr(op, this);
+    }
+    int len = length(op);
+    if (len > 1) {
+        _imm.bytes.l.u = _addr.Get(_pc.u + 1).u;
+    }
+    if (len > 2) {
+        _imm.bytes.h.u = _addr.Get(_pc.u + 2).u;
+    }
+    ++_instructions;
+    return RunOpcode<Tr>(op);
+}
 
-        if (_vid.vblank_int()) {
-            _addr.Set(0xFF0F, SetBit(_addr.Get(0xFF0F).u, 0));
-            cevent << "VBlank INT SET\n";
+int Z80::RunCached(uint64_t until) {
+    if (_code_version != _addr.code_version() || _op == _op_end ||
+        _op->pc != _pc.u) {
+        _code_version = _addr.code_version();
+        BlockCache::Block* block = _blocks.Find(_pc.u);
+        if (!block) {
+            _op = _op_end = nullptr;
+            return Interpret<NoTrace>();
         }
-        if (_vid.stat_int()) {
-            _addr.Set(0xFF0F, SetBit(_addr.Get(0xFF0F).u, 1));
-            cevent << "STAT INT SET\n";
+        _op = block->ops.data();
+        _op_end = _op + block->ops.size();
+        if (block->native || _jit) {
+            int cycles = RunNative(*block, until);
+            if (cycles) {
+                return cycles;
+            }
+        }
+    }
+    const BlockCache::Op& op = *_op++;
+    _imm.u = op.imm.u;
+    ++_instructions;
+    return op.run(this);
+}
+
+int Z80::RunNative(BlockCache::Block& block, uint64_t until) {
+    static const int kHotRuns = 8;
+    if (_jit && !block.native && block.runs < kHotRuns &&
+        ++block.runs == kHotRuns) {
+        if (!_jit->Translate(block) && _jit->full()) {
+            _blocks.ForgetNative();
+            _jit->Flush();
+            _jit->Translate(block);
         }
-        if (_timer.tima_int()) {
-            cevent << "TIMA INT\n";
-            _addr.Set(0xFF0F, SetBit(_addr.Get(0xFF0F).u, 2));
+    }
+    // Events are only processed between native runs, none may be due before
+    // the last instruction starts.
+    if (!block.native ||
+        _sched.now() + block.native_span >=
+            std::min(_sched.next_deadline(), until)) {
+        return 0;
+    }
+    // Native code works on F itself
+    set_flags(flags());
+    BlockCache::NativeExit exit;
+    int cycles = block.native(_regs, &exit, &_plain_memory);
+    _pc.u = exit.pc;
+    _op += exit.instructions;
+    _instructions += exit.instructions;
+    return cycles;
+}
+
+int Z80::IdleCycles(uint64_t until) const {
+    const uint64_t now = _sched.now();
+    const uint64_t wake = std::min(_sched.next_deadline(), until);
+    if (wake == kNever || wake <= now) {
+        return 4;
+    }
+    return (wake - now + 3) & ~uint64_t(3);
+}
+
+void Z80::ProcessEvent(Scheduler::Event e) {
+    switch (e) {
+        case Scheduler::PPU: {
+            ProfileScope scope(Profiler::VIDEO);
+            _vid.Step();
+            if (_vid.vblank_int()) {
+                _ints.Request(Interrupts::VBLANK);
+                cevent << "VBlank INT SET\n";
+                // Nobody reads the joypad while stopped
+                if (stopped() && _keypad.Poll()) {
+                    set_stop(false);
+                }
+            }
+            if (_vid.stat_int()) {
+                _ints.Request(Interrupts::STAT);
+                cevent << "STAT INT SET\n";
+            }
+            if (_keypad.pressed()) {
+                _ints.Request(Interrupts::JOYPAD);
+            }
+            break;
         }
-        if (_lk.transferred()) {
-            _addr.Set(0xFF0F, SetBit(_addr.Get(0xFF0F).u, 3));
+        case Scheduler::TIMER: {
+            ProfileScope scope(Profiler::DEVICES);
+            if (_timer.Step()) {
+                cevent << "TIMA INT\n";
+                _ints.Request(Interrupts::TIMER);
+            }
+            break;
         }
-        if (_keypad.pressed()) {
-            _addr.Set(0xFF0F, SetBit(_addr.Get(0xFF0F).u, 4));
+        case Scheduler::SERIAL: {
+            ProfileScope scope(Profiler::DEVICES);
+            _lk.Step();
+            _ints.Request(Interrupts::SERIAL);
+            break;
         }
-        cycles += ProcessInterrupts();
+        case Scheduler::APU:
+            _snd.Step();
+            break;
+        case Scheduler::DMA:
+            _addr.FinishDma();
+            break;
     }
 }
 
-void Z80::PrintInstr(uint8_t op, Z80* p) { _instr[op]->Print(p); }
-void Z80::PrintCBInstr(uint8_t op, Z80* p) { _cb_instr[op]->Print(p); }
-
+template <class Tr>
 int Z80::ProcessInterrupts() {
-    byte ints = _addr.Get(0xFFFF).u & _addr.Get(0xFF0F).u & _interrupts;
-
-    set_halt(halted() && !ints);
-    if (ints) {
-        --_pc.u;
+    byte ints = _ints.pending();
+    if (!ints) {
+        return 0;
     }
+
+    set_halt(false);
+    --_pc.u;
     if (ints & 1) {
         cevent << "VBlank int!\n";
-        _addr.Set(0xFF0F, ClearBit(_addr.Get(0xFF0F).u, 0));
-        return RST40<void, void>::Do(this);
+        _ints.Acknowledge(Interrupts::VBLANK);
+        return RST40<void, Tr>::Do(this);
     } else if (ints & 0b10) {
         cevent << "STAT int!\n";
-        _addr.Set(0xFF0F, ClearBit(_addr.Get(0xFF0F).u, 1));
-        return RST48<void, void>::Do(this);
+        _ints.Acknowledge(Interrupts::STAT);
+        return RST48<void, Tr>::Do(this);
     } else if (ints & 0b100) {
-        _addr.Set(0xFF0F, ClearBit(_addr.Get(0xFF0F).u, 2));
-        return RST50<void, void>::Do(this);
+        _ints.Acknowledge(Interrupts::TIMER);
+        return RST50<void, Tr>::Do(this);
     } else if (ints & 0b1000) {
-        _addr.Set(0xFF0F, ClearBit(_addr.Get(0xFF0F).u, 3));
-        return RST58<void, void>::Do(this);
+        _ints.Acknowledge(Interrupts::SERIAL);
+        return RST58<void, Tr>::Do(this);
     } else if (ints & 0b10000) {
-        _addr.Set(0xFF0F, ClearBit(_addr.Get(0xFF0F).u, 4));
-        return RST60<void, void>::Do(this);
+        _ints.Acknowledge(Interrupts::JOYPAD);
+        return RST60<void, Tr>::Do(this);
     }
     return 0;
 }
@@ -0,0 +1,200 @@
+// Checks that span rendering draws the same pixels as rendering pixel by
+// pixel, both for RenderSpan alone and for whole background and window
+// lines.
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "frontend/null.h"
+#include "gpu/video.h"
+#include "scheduler.h"
+
+namespace {
+
+std::mt19937 rng(42);
+
+int Random(int lo, int hi) {
+    return std::uniform_int_distribution<int>(lo, hi)(rng);
+}
+
+bool Same(const Color& a, const Color& b) {
+    return a.a == b.a && a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// RenderBlocks and RenderPixels against Pixel::Render, on random spans over
+// random priorities.
+bool CheckSpans() {
+    Palette palette;
+    for (int run = 0; run < 100000; ++run) {
+        palette.Set(Random(0, 255));
+        const Color table[4] = {palette.GetColor(0),
+                                palette.GetColor(1),
+                                palette.GetColor(2),
+                                palette.GetColor(3)};
+        const int n = Random(0, 160);
+        const byte z0 = Random(0, 5);
+        const byte z = Random(0, 5);
+
+        std::vector<byte> colors(n);
+        std::vector<Color> before(n);
+        std::vector<byte> prios(n);
+        for (int i = 0; i < n; ++i) {
+            colors[i] = Random(0, 3);
+            before[i] = palette.GetColor(Random(0, 3));
+            prios[i] = Random(0, 5);
+        }
+
+        std::vector<Color> ref = before;
+        std::vector<byte> ref_z = prios;
+        for (int i = 0; i < n; ++i) {
+            RenderZone::Pixel<Color&, byte&> pix(ref[i], ref_z[i]);
+            pix.Render(make_pixel(table[colors[i]], colors[i] ? z : z0));
+        }
+
+        std::vector<Color> blocks = before;
+        std::vector<byte> blocks_z = prios;
+        const int done = RenderZone::RenderBlocks(
+            blocks.data(), blocks_z.data(), colors.data(), n, table, z0, z);
+        RenderZone::RenderPixels(blocks.data() + done,
+                                 blocks_z.data() + done,
+                                 colors.data() + done,
+                                 n - done,
+                                 table,
+                                 z0,
+                                 z);
+
+        std::vector<Color> pixels = before;
+        std::vector<byte> pixels_z = prios;
+        RenderZone::RenderPixels(
+            pixels.data(), pixels_z.data(), colors.data(), n, table, z0, z);
+
+        for (int i = 0; i < n; ++i) {
+            if (!Same(blocks[i], ref[i]) || blocks_z[i] != ref_z[i] ||
+                !Same(pixels[i], ref[i]) || pixels_z[i] != ref_z[i]) {
+                std::cerr << "span " << run << ": pixel " << i << " of " << n
+                          << " differs\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The background and window registers a line was rendered with
+struct LineRegs {
+    byte lcdc;
+    byte scroll_x;
+    byte scroll_y;
+    byte wx;
+    byte wy;
+    byte palette;
+};
+
+// Color index of a background or window tile pixel, decoded from VRAM
+int TilePixel(const std::vector<byte>& vram, byte lcdc, byte tile, int x,
+              int y) {
+    const int base = (lcdc & 0x10) ? tile * 16 : 0x1000 + int8_t(tile) * 16;
+    const byte l = vram[base + y * 2];
+    const byte h = vram[base + y * 2 + 1];
+    return (((h >> (7 - x)) & 1) << 1) | ((l >> (7 - x)) & 1);
+}
+
+// The renderer before span rendering, one pixel at a time
+void RenderReference(RenderZone& zone,
+                     const std::vector<byte>& vram,
+                     const LineRegs& r,
+                     int line) {
+    Palette palette;
+    palette.Set(r.palette);
+    auto pixs = zone.pixs(line);
+
+    if (r.lcdc & 0x01) {
+        const int map = (r.lcdc & 0x08) ? 0x1C00 : 0x1800;
+        const int y = (line + r.scroll_y) % 256;
+        for (int px_num = 0; px_num < 160; ++px_num) {
+            const int x = (px_num + r.scroll_x) % 256;
+            const byte tile = vram[map + x / 8 + (y / 8) * 32];
+            const int color = TilePixel(vram, r.lcdc, tile, x % 8, y % 8);
+            pixs[px_num].Render(
+                make_pixel(palette.GetColor(color), color == 0 ? 0 : 2));
+        }
+    }
+
+    const int wx = r.wx - 7;
+    const int y_win = line - r.wy;
+    if ((r.lcdc & 0x20) && y_win >= 0) {
+        const int map = (r.lcdc & 0x40) ? 0x1C00 : 0x1800;
+        for (int x = std::max(0, wx); x < 160; ++x) {
+            const int x_win = x - wx;
+            const byte tile = vram[map + x_win / 8 + (y_win / 8) * 32];
+            const int color =
+                TilePixel(vram, r.lcdc, tile, x_win % 8, y_win % 8);
+            pixs[x].Render(make_pixel(palette.GetColor(color), 4));
+        }
+    }
+}
+
+// Whole frames through Video, with the registers changing on every line
+bool CheckFrames() {
+    Scheduler sched;
+    MemoryDisplay display;
+    Video video(sched, display);
+    MemoryDisplay ref_display;
+    RenderZone ref(ref_display);
+
+    std::vector<byte> vram(0x2000);
+    for (int frame = 0; frame < 200; ++frame) {
+        for (int i = 0; i < 0x2000; ++i) {
+            vram[i] = Random(0, 255);
+            video.set_vram(0x8000 + i, vram[i]);
+        }
+
+        const int frames = display.frames();
+        while (display.frames() == frames) {
+            const int line = video.y_coord();
+            // The next step renders the line
+            if (video.lcd_status() % 4 == 0 && line < 144) {
+                // LCD on, sprites off
+                const LineRegs r = {byte(0x80 | (Random(0, 255) & 0x79)),
+                                    byte(Random(0, 255)),
+                                    byte(Random(0, 255)),
+                                    byte(Random(0, 255)),
+                                    byte(Random(0, 160)),
+                                    byte(Random(0, 255))};
+                video.set_lcdc(r.lcdc);
+                video.set_scroll_x(r.scroll_x);
+                video.set_scroll_y(r.scroll_y);
+                video.set_win_x_pos(r.wx);
+                video.set_win_y_pos(r.wy);
+                video.set_bg_palette(r.palette);
+                RenderReference(ref, vram, r, line);
+                if (line == 143) {
+                    ref.Render();
+                }
+            }
+            sched.Advance(sched.deadline(Scheduler::PPU) - sched.now());
+            video.Step();
+        }
+
+        for (int i = 0; i < 160 * 144; ++i) {
+            if (!Same(display.frame()[i], ref_display.frame()[i])) {
+                std::cerr << "frame " << frame << ": pixel " << i % 160
+                          << " of line " << i / 160 << " differs\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main() {
+    if (!CheckSpans() || !CheckFrames()) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "render: OK\n";
+    return EXIT_SUCCESS;
+}
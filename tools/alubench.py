@@ -0,0 +1,92 @@
+#!/usr/bin/env python3
+"""Writes a ROM spinning in ALU-heavy loops, to measure the CPU core alone.
+
+    tools/alubench.py alu.gb
+    gamulator-bench --no-breakdown --frames 3000 alu.gb
+
+The LCD is turned off and interrupts are disabled, so nearly all the time goes
+to the interpreter. The inner loop chains 8-bit arithmetic whose flags are
+mostly overwritten before being read; the outer loop reads them all through
+DAA and PUSH AF.
+"""
+import sys
+
+# The inner loop, then the outer one, as (label, bytes) pairs. Branches are
+# resolved in assemble().
+INNER = [
+    ('inner', [0x81]),  # add a, c
+    (None, [0x8A]),  # adc a, d
+    (None, [0x93]),  # sub e
+    (None, [0x9C]),  # sbc a, h
+    (None, [0x0C]),  # inc c
+    (None, [0x15]),  # dec d
+    (None, [0xBD]),  # cp l
+    (None, [0x86]),  # add a, (hl)
+    (None, [0xCE, 0x37]),  # adc a, 0x37
+    (None, [0xA9]),  # xor c
+    (None, [0x1C]),  # inc e
+    (None, [0xD6, 0x11]),  # sub 0x11
+    (None, [0x38, 'skip']),  # jr c, skip
+    (None, [0x2C]),  # inc l
+    ('skip', [0x80]),  # add a, b
+    (None, [0xB2]),  # or d
+    (None, [0x05]),  # dec b
+    (None, [0x20, 'inner']),  # jr nz, inner
+]
+OUTER = [
+    (None, [0x27]),  # daa
+    (None, [0xF5]),  # push af
+    (None, [0xF1]),  # pop af
+    (None, [0xC3, 'outer', 'outer']),  # jp outer
+]
+START = 0x150
+
+
+def assemble() -> bytes:
+    setup = [
+        0xF3,  # di
+        0x31, 0xFE, 0xFF,  # ld sp, 0xfffe
+        0xAF,  # xor a
+        0xE0, 0x40,  # ldh (0x40), a: LCD off
+        0x21, 0x00, 0xC0,  # ld hl, 0xc000
+    ]
+    outer = [('outer', [0x06, 0x00])]  # ld b, 0
+    program = outer + INNER + OUTER
+
+    labels = {}
+    at = START + len(setup)
+    for label, code in program:
+        if label:
+            labels[label] = at
+        at += len(code)
+
+    out = bytearray(setup)
+    at = START + len(setup)
+    for _, code in program:
+        end = at + len(code)
+        if code[0] == 0xC3:
+            target = labels[code[1]]
+            code = [0xC3, target & 0xFF, target >> 8]
+        elif isinstance(code[-1], str):
+            code = [code[0], (labels[code[1]] - end) & 0xFF]
+        out += bytes(code)
+        at = end
+    return bytes(out)
+
+
+def main() -> None:
+    if len(sys.argv) != 2:
+        print('usage: alubench.py alu.gb')
+        sys.exit(1)
+    rom = bytearray(0x8000)
+    rom[0x100:0x104] = [0x00, 0xC3, START & 0xFF, START >> 8]  # nop; jp
+    rom[0x134:0x13C] = b'ALUBENCH'
+    code = assemble()
+    rom[START:START + len(code)] = code
+    rom[0x14D] = (-sum(rom[0x134:0x14D]) - 25) & 0xFF
+    with open(sys.argv[1], 'wb') as f:
+        f.write(rom)
+
+
+if __name__ == '__main__':
+    main()
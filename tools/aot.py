@@ -0,0 +1,486 @@
+#!/usr/bin/env python3
+"""Compiles the ROM blocks a game ran to C++, and builds them into a shared
+object that the emulators load with --aot.
+
+    emu-headless --frames 3000 --coverage game.cov game.gb
+    tools/aot.py game.gb game.cov game.so
+
+Blocks are cut like the block cache does, and compiled up to the first
+instruction needing more than registers and plain memory. At run time, native
+code stops before any access to IO, disabled cartridge RAM or watched code, and
+the interpreter takes over; code in RAM and blocks missing from the coverage are
+interpreted (or JIT compiled) as usual.
+"""
+import os
+import subprocess
+import sys
+from typing import List, Optional, Tuple
+
+ABI = 1
+
+LENGTHS = [
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,
+    1, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+] + [1] * 128 + [
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1,
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,
+]
+
+# stop, jr, halt, ret, reti, jp, call and rst
+ENDS_BLOCK = {0x10, 0x18, 0x20, 0x28, 0x30, 0x38, 0x76, 0xC0, 0xC8, 0xC9,
+              0xD0, 0xD8, 0xD9, 0xC2, 0xC3, 0xCA, 0xD2, 0xDA, 0xE9, 0xC4,
+              0xCC, 0xCD, 0xD4, 0xDC, 0xC7, 0xCF, 0xD7, 0xDF, 0xE7, 0xEF,
+              0xF7, 0xFF}
+
+# Operands of the opcodes, in their B, C, D, E, H, L, (HL), A order
+REGS = ['b', 'c', 'd', 'e', 'h', 'l', None, 'a']
+PAIRS = [('b', 'c'), ('d', 'e'), ('h', 'l')]
+
+KEEP_Z = 'f >> 7 & 1'
+KEEP_N = 'f >> 6 & 1'
+KEEP_C = 'f >> 4 & 1'
+
+
+class Instr:
+    def __init__(self, rom: bytes, offset: int, pc: int) -> None:
+        self.offset = offset
+        self.pc = pc
+        self.op = rom[offset]
+        self.len = LENGTHS[self.op]
+        self.imm8 = rom[offset + 1] if self.len > 1 else 0
+        self.imm16 = self.imm8 | (rom[offset + 2] << 8 if self.len > 2 else 0)
+
+    @property
+    def next_pc(self) -> int:
+        return (self.pc + self.len) & 0xFFFF
+
+
+def decode(rom: bytes, offset: int, pc: int) -> List[Instr]:
+    """The block starting at offset, as BlockCache::Find cuts it"""
+    end = (offset | 0xFF) + 1
+    block = []
+    while offset < end:
+        instr = Instr(rom, offset, pc)
+        if offset + instr.len > end:
+            break
+        block.append(instr)
+        offset += instr.len
+        pc += instr.len
+        if instr.op in ENDS_BLOCK:
+            break
+    return block
+
+
+class Block:
+    """C++ for one block. Each instruction checks its memory accesses
+    before changing anything, and bails out to the interpreter if needed."""
+
+    def __init__(self, instrs: List[Instr]) -> None:
+        self.instrs = instrs
+        self.lines = []  # type: List[str]
+        self.n = 0
+        self.cycles = 0
+        self.span = 0
+        self.done = False
+
+    def emit(self, line: str) -> None:
+        self.lines.append('    ' + line)
+
+    def bail(self, instr: Instr) -> str:
+        return 'EXIT(0x%04X, %d, %d);' % (instr.pc, self.n, self.cycles)
+
+    def pointer(self, instr: Instr, fn: str, addr: str,
+                write: bool = False) -> str:
+        """Points p, or w for writes, to addr"""
+        ptr = 'w' if write else 'p'
+        self.emit('if (!(%s = aot::%s(m, %s))) %s' %
+                  (ptr, fn, addr, self.bail(instr)))
+        return '*' + ptr
+
+    def hl(self, instr: Instr, write: bool) -> str:
+        return self.pointer(instr, 'Write' if write else 'Read', 'h << 8 | l',
+                            write)
+
+    def flags(self, z: str, n: str, h: str, c: str) -> None:
+        self.emit('f = aot::Flags(%s, %s, %s, %s, f);' % (z, n, h, c))
+
+    def operand(self, instr: Instr, r: int) -> str:
+        """C expression of operand r, loading (HL) in v"""
+        if REGS[r]:
+            return REGS[r]
+        self.emit('v = %s;' % self.hl(instr, False))
+        return 'v'
+
+    def alu(self, kind: int, v: str) -> None:
+        if kind in (0, 1):  # add, adc
+            k = ' + k' if kind == 1 else ''
+            if kind == 1:
+                self.emit('k = f >> 4 & 1;')
+            self.emit('t = a + %s%s;' % (v, k))
+            self.flags('!(t & 0xFF)', '0',
+                       '((a & 0xF) + (%s & 0xF)%s) >> 4' % (v, k), 't >> 8')
+            self.emit('a = t & 0xFF;')
+        elif kind in (2, 3, 7):  # sub, sbc, cp
+            if kind == 3:
+                self.emit('k = f >> 4 & 1;')
+            self.emit('t = a - %s%s;' % (v, ' - k' if kind == 3 else ''))
+            self.flags('!(t & 0xFF)', '1', '(a ^ %s ^ t) & 0x10' % v,
+                       't & 0x100')
+            if kind != 7:
+                self.emit('a = t & 0xFF;')
+        else:
+            self.emit('a %s= %s;' % ({4: '&', 5: '^', 6: '|'}[kind], v))
+            self.flags('!a', '0', '1' if kind == 4 else '0', '0')
+
+    def shift(self, kind: int, v: str, zero: Optional[str] = None) -> None:
+        """Rotations and shifts of the 0xCB prefix, and swap"""
+        if kind == 0:  # rlc
+            self.emit('%s = (%s << 1 | %s >> 7) & 0xFF;' % (v, v, v))
+            carry = '%s & 1' % v
+        elif kind == 1:  # rrc
+            self.emit('%s = %s >> 1 | (%s & 1) << 7;' % (v, v, v))
+            carry = '%s >> 7' % v
+        elif kind == 2:  # rl
+            self.emit('t = %s << 1 | (f >> 4 & 1);' % v)
+            self.emit('%s = t & 0xFF;' % v)
+            carry = 't >> 8'
+        elif kind == 3:  # rr
+            self.emit('t = %s & 1;' % v)
+            self.emit('%s = %s >> 1 | (f >> 4 & 1) << 7;' % (v, v))
+            carry = 't'
+        elif kind == 4:  # sla
+            self.emit('t = %s >> 7;' % v)
+            self.emit('%s = %s << 1 & 0xFF;' % (v, v))
+            carry = 't'
+        elif kind == 5:  # sra
+            self.emit('t = %s & 1;' % v)
+            self.emit('%s = %s >> 1 | (%s & 0x80);' % (v, v, v))
+            carry = 't'
+        elif kind == 6:  # swap
+            self.emit('%s = (%s << 4 | %s >> 4) & 0xFF;' % (v, v, v))
+            carry = '0'
+        else:  # srl
+            self.emit('t = %s & 1;' % v)
+            self.emit('%s >>= 1;' % v)
+            carry = 't'
+        self.flags(zero or '!%s' % v, '0', '0', carry)
+
+    def extended(self, instr: Instr) -> Optional[int]:
+        op = instr.imm8
+        kind = op >> 3 & 7
+        r = op & 7
+        v = REGS[r]
+        if not v:
+            mem = self.hl(instr, op < 0x40 or op >= 0x80)
+            self.emit('v = %s;' % mem)
+            v = 'v'
+        if op < 0x40:
+            self.shift(kind, v)
+        elif op < 0x80:  # bit
+            self.flags('!(%s & 0x%02X)' % (v, 1 << kind), '0', '1', KEEP_C)
+            return 12 if r == 6 else 8
+        elif op < 0xC0:  # res
+            self.emit('%s &= 0x%02X;' % (v, ~(1 << kind) & 0xFF))
+        else:  # set
+            self.emit('%s |= 0x%02X;' % (v, 1 << kind))
+        if r == 6:
+            self.emit('%s = v;' % mem)
+            return 16
+        return 8
+
+    def high(self, instr: Instr, n: str, write: bool) -> str:
+        return self.pointer(instr, 'High', '%s, %s' %
+                            (n, 'true' if write else 'false'), write)
+
+    def instruction(self, instr: Instr) -> Optional[int]:
+        """Emits instr, returning its cycles, or None if it can't be
+        compiled"""
+        op = instr.op
+        x = op >> 3 & 7
+        y = op & 7
+        if 0x40 <= op < 0x80 and op != 0x76:
+            if x == 6:
+                self.emit('%s = %s;' % (self.hl(instr, True), REGS[y]))
+                return 8
+            self.emit('%s = %s;' % (REGS[x], self.operand(instr, y)))
+            return 8 if y == 6 else 4
+        if 0x80 <= op < 0xC0:
+            self.alu(x, self.operand(instr, y))
+            return 8 if y == 6 else 4
+        if op & 0xC7 == 0xC6:
+            self.alu(x, '0x%02X' % instr.imm8)
+            return 8
+        if op & 0xC6 == 0x04:  # inc, dec
+            dec = op & 1
+            if x == 6:
+                mem = self.hl(instr, True)
+                self.emit('v = %s;' % mem)
+            v = REGS[x] or 'v'
+            if dec:
+                self.flags('%s == 1' % v, '1', '(%s & 0xF) == 0' % v, KEEP_C)
+                self.emit('%s = (%s - 1) & 0xFF;' % (v, v))
+            else:
+                self.flags('%s == 0xFF' % v, '0', '(%s & 0xF) == 0xF' % v,
+                           KEEP_C)
+                self.emit('%s = (%s + 1) & 0xFF;' % (v, v))
+            if x == 6:
+                self.emit('%s = v;' % mem)
+                return 12
+            return 4
+        if op & 0xC7 == 0x06:  # ld r, n
+            if x == 6:
+                self.emit('%s = 0x%02X;' % (self.hl(instr, True),
+                                             instr.imm8))
+                return 12
+            self.emit('%s = 0x%02X;' % (REGS[x], instr.imm8))
+            return 8
+        if op & 0xCF == 0x01 and op != 0x31:  # ld rr, nn
+            hi, lo = PAIRS[op >> 4]
+            self.emit('%s = 0x%02X;' % (hi, instr.imm16 >> 8))
+            self.emit('%s = 0x%02X;' % (lo, instr.imm16 & 0xFF))
+            return 12
+        if op & 0xC7 == 0x03 and op not in (0x33, 0x3B):  # inc rr, dec rr
+            hi, lo = PAIRS[op >> 4]
+            self.emit('t = (%s << 8 | %s) %s 1;' % (hi, lo,
+                                                   '-' if op & 8 else '+'))
+            self.emit('%s = t >> 8 & 0xFF;' % hi)
+            self.emit('%s = t & 0xFF;' % lo)
+            return 8
+        if op & 0xCF == 0x09 and op != 0x39:  # add hl, rr
+            hi, lo = PAIRS[op >> 4]
+            self.emit('k = %s << 8 | %s;' % (hi, lo))
+            self.emit('t = (h << 8 | l) + k;')
+            self.flags(KEEP_Z, '0', '(((h << 8 | l) & 0xFFF) + (k & 0xFFF)) '
+                       '>> 12', 't >> 16')
+            self.emit('h = t >> 8 & 0xFF;')
+            self.emit('l = t & 0xFF;')
+            return 8
+        if op in (0x02, 0x12):
+            hi, lo = PAIRS[op >> 4]
+            mem = self.pointer(instr, 'Write', '%s << 8 | %s' % (hi, lo),
+                               True)
+            self.emit('%s = a;' % mem)
+            return 8
+        if op in (0x0A, 0x1A):
+            hi, lo = PAIRS[op >> 4]
+            mem = self.pointer(instr, 'Read', '%s << 8 | %s' % (hi, lo))
+            self.emit('a = %s;' % mem)
+            return 8
+        if op in (0x22, 0x32, 0x2A, 0x3A):  # ldi, ldd
+            write = not op & 8
+            mem = self.hl(instr, write)
+            self.emit(('%s = a;' if write else 'a = %s;') % mem)
+            self.emit('t = (h << 8 | l) %s 1;' % ('+' if op < 0x30 else '-'))
+            self.emit('h = t >> 8 & 0xFF;')
+            self.emit('l = t & 0xFF;')
+            return 8
+        if op in (0x07, 0x0F, 0x17, 0x1F):  # rlca, rrca, rla, rra
+            self.shift(x, 'a', zero='0')
+            return 4
+        if op == 0x27:  # daa
+            self.emit('t = a;')
+            self.emit('k = f >> 4 & 1;')
+            self.emit('if (!(f & 0x40)) {')
+            self.emit('    if ((t & 0x0F) > 9 || (f & 0x20)) t += 6;')
+            self.emit('    if (t > 0x9F || k) { t += 0x60; k = 1; }')
+            self.emit('} else {')
+            self.emit('    if (f & 0x20) t = (t - 6) & 0xFF;')
+            self.emit('    if (k) t -= 0x60;')
+            self.emit('}')
+            self.emit('if (t & 0xFF00) k = 1;')
+            self.flags('!(t & 0xFF)', KEEP_N, '0', 'k')
+            self.emit('a = t & 0xFF;')
+            return 4
+        if op == 0x2F:  # cpl
+            self.emit('a ^= 0xFF;')
+            self.flags(KEEP_Z, '1', '1', KEEP_C)
+            return 4
+        if op == 0x37:  # scf
+            self.flags(KEEP_Z, '0', '0', '1')
+            return 4
+        if op == 0x3F:  # ccf
+            self.flags(KEEP_Z, '0', '0', '!(f & 0x10)')
+            return 4
+        if op in (0xE0, 0xF0):
+            if instr.imm8 < 0x80 or instr.imm8 == 0xFF:
+                return None
+            mem = self.high(instr, '0x%02X' % instr.imm8, op == 0xE0)
+            self.emit(('%s = a;' if op == 0xE0 else 'a = %s;') % mem)
+            return 12
+        if op in (0xE2, 0xF2):
+            mem = self.high(instr, 'c', op == 0xE2)
+            self.emit(('%s = a;' if op == 0xE2 else 'a = %s;') % mem)
+            return 8
+        if op in (0xEA, 0xFA):
+            write = op == 0xEA
+            if instr.imm16 >= 0xFF00:
+                if instr.imm16 < 0xFF80 or instr.imm16 == 0xFFFF:
+                    return None
+                mem = self.high(instr, '0x%02X' % (instr.imm16 & 0xFF),
+                                write)
+            else:
+                mem = self.pointer(instr, 'Write' if write else 'Read',
+                                   '0x%04X' % instr.imm16, write)
+            self.emit(('%s = a;' if write else 'a = %s;') % mem)
+            return 16
+        if op == 0x00:
+            return 4
+        if op == 0xCB:
+            return self.extended(instr)
+        return None
+
+    def branch(self, instr: Instr) -> Optional[int]:
+        """Emits the exits of jr and jp, returning the cycles of the longest
+        path"""
+        op = instr.op
+        if op == 0x18 or op & 0xE7 == 0x20:
+            target = (instr.next_pc + (instr.imm8 ^ 0x80) - 0x80) & 0xFFFF
+            taken, not_taken = 12, 8
+        elif op == 0xC3 or op & 0xE7 == 0xC2:
+            target = instr.imm16
+            taken, not_taken = 16, 12
+        elif op == 0xE9:
+            self.emit('EXIT(h << 8 | l, %d, %d);' % (self.n + 1,
+                                                     self.cycles + 4))
+            return 4
+        else:
+            return None
+        if op not in (0x18, 0xC3):
+            flag = ['!(f & 0x80)', 'f & 0x80', '!(f & 0x10)', 'f & 0x10']
+            self.emit('if (%s) EXIT(0x%04X, %d, %d);' %
+                      (flag[x_of(op) & 3], target, self.n + 1,
+                       self.cycles + taken))
+            self.emit('EXIT(0x%04X, %d, %d);' % (instr.next_pc, self.n + 1,
+                                                 self.cycles + not_taken))
+        else:
+            self.emit('EXIT(0x%04X, %d, %d);' % (target, self.n + 1,
+                                                 self.cycles + taken))
+        return taken
+
+    def compile(self) -> bool:
+        for instr in self.instrs:
+            self.emit('// 0x%04X' % instr.pc)
+            start = len(self.lines)
+            cycles = self.branch(instr)
+            branched = cycles is not None
+            if not branched:
+                cycles = self.instruction(instr)
+            if cycles is None:
+                del self.lines[start - 1:]
+                break
+            self.span = self.cycles
+            self.cycles += cycles
+            self.n += 1
+            if branched:
+                return self.n > 0
+        if self.n == 0:
+            return False
+        last = self.instrs[self.n - 1]
+        self.emit('EXIT(0x%04X, %d, %d);' % (last.next_pc, self.n,
+                                             self.cycles))
+        return True
+
+
+def x_of(op: int) -> int:
+    return op >> 3 & 7
+
+
+def read_coverage(filename: str) -> List[Tuple[int, int]]:
+    blocks = []
+    with open(filename) as f:
+        for line in f:
+            if line.strip():
+                offset, pc = line.split()
+                blocks.append((int(offset, 16), int(pc, 16)))
+    return blocks
+
+
+PRELUDE = '''// Generated by tools/aot.py from %s, do not edit.
+
+#include "aot.h"
+
+#define EXIT(pc_, n_, cycles_)   \\
+    do {                         \\
+        exit->pc = (pc_);        \\
+        exit->instructions = n_; \\
+        cycles = cycles_;        \\
+        goto out;                \\
+    } while (0)
+
+namespace {
+'''
+
+FUNCTION_BEGIN = '''
+// rom 0x%X
+int Block_%X_%04X(Data8* r,
+                  BlockCache::NativeExit* exit,
+                  const AddressBus::PlainMemory* m) {
+    unsigned b = r[0].u, c = r[1].u, d = r[2].u, e = r[3].u;
+    unsigned h = r[4].u, l = r[5].u, f = r[6].u, a = r[7].u;
+    unsigned t, k, v;
+    int cycles;
+    const byte* p;
+    byte* w;
+'''
+
+FUNCTION_END = '''out:
+    r[0].u = b, r[1].u = c, r[2].u = d, r[3].u = e;
+    r[4].u = h, r[5].u = l, r[6].u = f, r[7].u = a;
+    return cycles;
+}
+'''
+
+
+def generate(gamefile: str, rom: bytes,
+             coverage: List[Tuple[int, int]]) -> str:
+    out = [PRELUDE % os.path.basename(gamefile)]
+    table = []
+    for offset, pc in coverage:
+        instrs = decode(rom, offset, pc)
+        block = Block(instrs)
+        if not block.compile():
+            continue
+        size = instrs[block.n - 1].offset + instrs[block.n - 1].len - offset
+        name = 'Block_%X_%04X' % (offset, pc)
+        out.append(FUNCTION_BEGIN % (offset, offset, pc))
+        out.extend(line + '\n' for line in block.lines)
+        out.append(FUNCTION_END)
+        code = ', '.join('0x%02X' % x for x in rom[offset:offset + size])
+        out.append('const byte Code_%X_%04X[] = {%s};\n' % (offset, pc, code))
+        table.append('    {0x%X, 0x%04X, %d, Code_%X_%04X, %d, %s},\n' %
+                     (offset, pc, size, offset, pc, block.span, name))
+    out.append('\n}  // namespace\n\n')
+    out.append('extern "C" const int gamulator_aot_abi = %d;\n' % ABI)
+    out.append('extern "C" const int gamulator_aot_nb_blocks = %d;\n' %
+               len(table))
+    out.append('extern "C" const Aot::Block gamulator_aot_blocks[] = {\n')
+    out.extend(table or ['    {0, 0, 0, nullptr, 0, nullptr},\n'])
+    out.append('};\n')
+    return ''.join(out)
+
+
+def main() -> None:
+    if len(sys.argv) != 4:
+        print('usage: aot.py game.gb coverage game.so|game.cpp')
+        sys.exit(1)
+    gamefile, coverage, output = sys.argv[1:]
+    with open(gamefile, 'rb') as f:
+        rom = f.read()
+    source = generate(gamefile, rom, read_coverage(coverage))
+    cpp = output if output.endswith('.cpp') else output + '.cpp'
+    with open(cpp, 'w') as f:
+        f.write(source)
+    if cpp != output:
+        src = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..',
+                           'src')
+        cxx = os.environ.get('CXX', 'c++')
+        subprocess.check_call([cxx, '-std=c++14', '-O2', '-fPIC', '-shared',
+                               '-I', src, cpp, '-o', output])
+
+
+if __name__ == '__main__':
+    main()